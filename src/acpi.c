@@ -0,0 +1,99 @@
+#include "acpi.h"
+#include "bootinfo.h"
+#include <stdint.h>
+
+struct sdt_header {
+    char     sig[4];
+    uint32_t length;
+    uint8_t  revision;
+    uint8_t  checksum;
+    char     oem_id[6];
+    char     oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed));
+
+#define MADT_LAPIC          0
+#define MADT_IOAPIC         1
+#define MADT_ISO            2       /* interrupt source override */
+#define MADT_LAPIC_ADDR     5
+
+static struct acpi_madt madt;
+
+static int checksum_ok(const void *p, uint32_t len){
+    const uint8_t *b = (const uint8_t*)p;
+    uint8_t sum = 0;
+    for(uint32_t i=0;i<len;i++) sum += b[i];
+    return sum == 0;
+}
+
+static int sig_is(const char *s, const char *want){
+    for(int i=0;i<4;i++) if(s[i] != want[i]) return 0;
+    return 1;
+}
+
+static const struct sdt_header* find_table(const char *sig){
+    const uint8_t *rsdp = (const uint8_t*)bootinfo_get()->rsdp;
+    if(!rsdp) return 0;
+
+    /* RSDT (32-bit entries) at offset 16, XSDT (64-bit) at 24 in v2 */
+    uint32_t rsdt = *(const uint32_t*)(rsdp + 16);
+    uint32_t xsdt = 0;
+    if(rsdp[15] >= 2 && *(const uint32_t*)(rsdp + 28) == 0)
+        xsdt = *(const uint32_t*)(rsdp + 24);
+
+    const struct sdt_header *root = (const struct sdt_header*)(uintptr_t)(xsdt ? xsdt : rsdt);
+    if(!root || !checksum_ok(root, root->length)) return 0;
+
+    uint32_t esz = xsdt ? 8 : 4;
+    uint32_t n = (root->length - sizeof(*root)) / esz;
+    const uint8_t *e = (const uint8_t*)(root + 1);
+    for(uint32_t i=0;i<n;i++, e += esz){
+        if(esz == 8 && *(const uint32_t*)(e + 4)) continue;     /* above 4 GiB */
+        const struct sdt_header *h = (const struct sdt_header*)(uintptr_t)*(const uint32_t*)e;
+        if(h && sig_is(h->sig, sig) && checksum_ok(h, h->length)) return h;
+    }
+    return 0;
+}
+
+void acpi_init(void){
+    for(int i=0;i<16;i++){ madt.irq_gsi[i] = (uint32_t)i; madt.irq_flags[i] = 0; }
+
+    const struct sdt_header *h = find_table("APIC");
+    if(!h) return;
+
+    const uint8_t *p = (const uint8_t*)h;
+    madt.lapic_addr = *(const uint32_t*)(p + 36);
+
+    for(uint32_t off = 44; off + 2 <= h->length; ){
+        uint8_t type = p[off], len = p[off+1];
+        if(len < 2) break;
+        const uint8_t *e = p + off;
+        switch(type){
+        case MADT_LAPIC:
+            if(*(const uint32_t*)(e + 4) & 1) madt.ncpus++;
+            break;
+        case MADT_IOAPIC:
+            if(!madt.ioapic_addr){
+                madt.ioapic_id       = e[2];
+                madt.ioapic_addr     = *(const uint32_t*)(e + 4);
+                madt.ioapic_gsi_base = *(const uint32_t*)(e + 8);
+            }
+            break;
+        case MADT_ISO:
+            if(e[2] == 0 && e[3] < 16){             /* bus 0 = ISA */
+                madt.irq_gsi[e[3]]   = *(const uint32_t*)(e + 4);
+                madt.irq_flags[e[3]] = *(const uint16_t*)(e + 8);
+            }
+            break;
+        case MADT_LAPIC_ADDR:
+            if(*(const uint32_t*)(e + 8) == 0) madt.lapic_addr = *(const uint32_t*)(e + 4);
+            break;
+        }
+        off += len;
+    }
+    madt.found = 1;
+}
+
+const struct acpi_madt* acpi_madt(void){ return &madt; }
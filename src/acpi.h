@@ -0,0 +1,23 @@
+#ifndef ACPI_H
+#define ACPI_H
+#include <stdint.h>
+
+/* Interrupt routing from the ACPI MADT ("APIC" table), found through the
+   RSDP that GRUB passes in the Multiboot2 info. */
+struct acpi_madt {
+    int      found;
+    uint32_t lapic_addr;
+    uint32_t ioapic_addr;       /* first I/O APIC, 0 if none */
+    uint32_t ioapic_gsi_base;
+    uint8_t  ioapic_id;
+    uint32_t ncpus;             /* enabled local APICs */
+    uint32_t irq_gsi[16];       /* ISA IRQ -> GSI, identity unless overridden */
+    uint16_t irq_flags[16];     /* MPS INTI polarity/trigger flags */
+};
+
+/* Reads the tables in place by physical address, so call it before
+   paging_init (the tables usually live above the identity map). */
+void acpi_init(void);
+const struct acpi_madt* acpi_madt(void);
+
+#endif
@@ -0,0 +1,216 @@
+#include "intc.h"
+#include "acpi.h"
+#include "irq.h"
+#include "paging.h"
+#include "tsc.h"
+#include "math64.h"
+#include <stdint.h>
+
+/* Local APIC + I/O APIC backend. The LAPIC timer provides the tick
+   (TSC-deadline mode when the CPU has it, else periodic mode calibrated
+   against the PIT); ISA IRQs are routed through the first I/O APIC as
+   described by the MADT. EOI is a single MMIO write instead of port I/O. */
+
+#define LAPIC_ID            0x020
+#define LAPIC_TPR           0x080
+#define LAPIC_EOI           0x0B0
+#define LAPIC_SVR           0x0F0
+#define LAPIC_LVT_TIMER     0x320
+#define LAPIC_TIMER_INIT    0x380
+#define LAPIC_TIMER_CUR     0x390
+#define LAPIC_TIMER_DIV     0x3E0
+
+#define LVT_MASKED          (1u << 16)
+#define LVT_PERIODIC        (1u << 17)
+#define LVT_TSC_DEADLINE    (2u << 17)
+#define TIMER_DIV_16        0x3
+
+#define IOAPIC_VER          0x01
+#define IOAPIC_REDIR(n)     (0x10 + 2*(n))
+#define REDIR_ACTIVE_LOW    (1u << 13)
+#define REDIR_LEVEL         (1u << 15)
+#define REDIR_MASKED        (1u << 16)
+
+#define MSR_APIC_BASE       0x1B
+#define MSR_TSC_DEADLINE    0x6E0
+#define APIC_BASE_ENABLE    (1u << 11)
+
+#define VECTOR_BASE         32
+#define VECTOR_SPURIOUS     0xFF
+#define CALIBRATE_MS        10u
+
+static volatile uint32_t *lapic;
+static volatile uint32_t *ioapic;
+static uint32_t ioapic_pins;
+static uint32_t lapic_id;
+static int has_deadline;
+
+static uint32_t timer_freq;         /* LAPIC timer Hz after the /16 divider */
+static uint32_t period_count;       /* periodic mode */
+static uint64_t period_tsc;         /* TSC-deadline mode */
+static uint64_t next_deadline;
+static int use_deadline;
+static int oneshot;                 /* tick stopped, see apic_timer_oneshot */
+
+static inline void cpuid(uint32_t leaf,uint32_t* a,uint32_t* b,uint32_t* c,uint32_t* d){
+    __asm__ volatile("cpuid":"=a"(*a),"=b"(*b),"=c"(*c),"=d"(*d):"a"(leaf),"c"(0));
+}
+
+static inline uint64_t rdmsr(uint32_t msr){
+    uint32_t lo, hi;
+    __asm__ volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t v){
+    __asm__ volatile("wrmsr" :: "c"(msr), "a"((uint32_t)v), "d"((uint32_t)(v >> 32)));
+}
+
+static inline uint32_t lapic_read(uint32_t reg){ return lapic[reg/4]; }
+static inline void lapic_write(uint32_t reg, uint32_t v){ lapic[reg/4] = v; }
+
+static uint32_t ioapic_read(uint32_t reg){ ioapic[0] = reg; return ioapic[4]; }
+static void ioapic_write(uint32_t reg, uint32_t v){ ioapic[0] = reg; ioapic[4] = v; }
+
+/* spurious interrupts need no EOI */
+__attribute__((naked)) static void apic_spurious_stub(void){
+    __asm__ volatile("iret");
+}
+
+static int apic_init(void){
+    uint32_t a, b, c, d;
+    cpuid(1, &a, &b, &c, &d);
+    if(!(d & (1u << 9))) return -1;                 /* no local APIC */
+    has_deadline = (c >> 24) & 1;
+
+    const struct acpi_madt *m = acpi_madt();
+    if(!m->found || !m->lapic_addr || !m->ioapic_addr) return -1;
+
+    uint32_t mmio = PAGE_RW | PAGE_PCD | PAGE_PWT;
+    if(paging_map_identity(m->lapic_addr, 4096, mmio) < 0) return -1;
+    if(paging_map_identity(m->ioapic_addr, 4096, mmio) < 0) return -1;
+    lapic  = (volatile uint32_t*)(uintptr_t)m->lapic_addr;
+    ioapic = (volatile uint32_t*)(uintptr_t)m->ioapic_addr;
+
+    pic_disable();
+    irq_set_gate(VECTOR_SPURIOUS, apic_spurious_stub, IDT_GATE_INT);
+
+    wrmsr(MSR_APIC_BASE, rdmsr(MSR_APIC_BASE) | APIC_BASE_ENABLE);
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, 0x100 | VECTOR_SPURIOUS);
+    lapic_id = lapic_read(LAPIC_ID) >> 24;
+
+    ioapic_pins = ((ioapic_read(IOAPIC_VER) >> 16) & 0xFF) + 1;
+    for(uint32_t i=0;i<ioapic_pins;i++){
+        ioapic_write(IOAPIC_REDIR(i), REDIR_MASKED);
+        ioapic_write(IOAPIC_REDIR(i) + 1, 0);
+    }
+    return 0;
+}
+
+static void apic_unmask(int irq){
+    if(irq < 0 || irq >= 16) return;
+    const struct acpi_madt *m = acpi_madt();
+    uint32_t pin = m->irq_gsi[irq] - m->ioapic_gsi_base;
+    if(pin >= ioapic_pins) return;
+
+    /* ISA defaults are edge/active-high; overrides say otherwise */
+    uint32_t lo = VECTOR_BASE + (uint32_t)irq;
+    uint16_t fl = m->irq_flags[irq];
+    if((fl & 3) == 3) lo |= REDIR_ACTIVE_LOW;
+    if(((fl >> 2) & 3) == 3) lo |= REDIR_LEVEL;
+    ioapic_write(IOAPIC_REDIR(pin) + 1, lapic_id << 24);
+    ioapic_write(IOAPIC_REDIR(pin), lo);
+}
+
+static void apic_eoi(int irq){
+    (void)irq;
+    lapic_write(LAPIC_EOI, 0);
+}
+
+static void apic_timer_start(uint32_t hz){
+    /* calibrate once: count down from the maximum across a PIT-timed 10 ms window */
+    if(!timer_freq){
+        lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+        lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+        lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFFu);
+        pit_delay_ms(CALIBRATE_MS);
+        uint32_t elapsed = 0xFFFFFFFFu - lapic_read(LAPIC_TIMER_CUR);
+        lapic_write(LAPIC_TIMER_INIT, 0);
+        timer_freq = elapsed * (1000u / CALIBRATE_MS);
+    }
+    oneshot = 0;
+
+    if(has_deadline && tsc_khz()){
+        period_tsc = div64_32((uint64_t)tsc_khz() * 1000u, hz, 0);
+        use_deadline = 1;
+        lapic_write(LAPIC_LVT_TIMER, VECTOR_BASE | LVT_TSC_DEADLINE);
+        __asm__ volatile("mfence" ::: "memory");    /* LVT write before the MSR */
+        next_deadline = rdtsc() + period_tsc;
+        wrmsr(MSR_TSC_DEADLINE, next_deadline);
+        return;
+    }
+
+    period_count = timer_freq / hz;
+    lapic_write(LAPIC_LVT_TIMER, VECTOR_BASE | LVT_PERIODIC);
+    lapic_write(LAPIC_TIMER_INIT, period_count);
+}
+
+static void apic_timer_oneshot(uint64_t tsc){
+    oneshot = 1;
+    if(use_deadline){
+        next_deadline = tsc;
+        wrmsr(MSR_TSC_DEADLINE, tsc);       /* a past deadline fires at once */
+        return;
+    }
+    uint64_t now = rdtsc();
+    uint32_t count = 1;
+    if(tsc > now){
+        uint64_t c = div64_32(tsc_to_ns(tsc - now) * (timer_freq / 1000u), 1000000u, 0) + 1;
+        count = c > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)c;
+    }
+    lapic_write(LAPIC_LVT_TIMER, VECTOR_BASE);      /* one-shot mode */
+    lapic_write(LAPIC_TIMER_INIT, count);
+}
+
+/* TSC-deadline mode is one-shot: arm the next tick from the previous
+   deadline so the period does not drift with interrupt latency */
+static void apic_timer_ack(void){
+    if(!use_deadline || oneshot) return;
+    next_deadline += period_tsc;
+    uint64_t now = rdtsc();
+    if((int64_t)(next_deadline - now) <= 0) next_deadline = now + period_tsc;  /* missed ticks */
+    wrmsr(MSR_TSC_DEADLINE, next_deadline);
+}
+
+static uint32_t apic_timer_delay_ns(void){
+    if(use_deadline){
+        uint64_t now = rdtsc();
+        if(now < next_deadline) return 0;
+        return (uint32_t)tsc_to_ns(now - next_deadline);
+    }
+    if(!timer_freq || oneshot) return 0;             /* expired one-shot reads 0 */
+    uint32_t cur = lapic_read(LAPIC_TIMER_CUR);
+    if(cur > period_count) return 0;
+    return (uint32_t)div64_32((uint64_t)(period_count - cur) * 1000000000u, timer_freq, 0);
+}
+
+static const char* apic_timer_mode(void){
+    if(use_deadline) return oneshot ? "LAPIC TSC-deadline, one-shot" : "LAPIC TSC-deadline";
+    return oneshot ? "LAPIC one-shot" : "LAPIC periodic";
+}
+
+uint32_t apic_timer_freq(void){ return timer_freq; }
+uint32_t apic_ioapic_pins(void){ return ioapic_pins; }
+
+const struct intc intc_apic = {
+    .name           = "LAPIC + I/O APIC",
+    .init           = apic_init,
+    .unmask         = apic_unmask,
+    .eoi            = apic_eoi,
+    .timer_start    = apic_timer_start,
+    .timer_oneshot  = apic_timer_oneshot,
+    .timer_ack      = apic_timer_ack,
+    .timer_delay_ns = apic_timer_delay_ns,
+    .timer_mode     = apic_timer_mode,
+};
@@ -0,0 +1,147 @@
+#include "batch.h"
+#include "shell.h"
+#include "klog.h"
+#include "tsc.h"
+#include "math64.h"
+#include <stdint.h>
+
+enum { ST_CMD, ST_REPEAT, ST_SLEEP, ST_LOOP, ST_END };
+
+struct stmt {
+    uint8_t  kind;
+    uint16_t match;         /* ST_LOOP: index of its `end` */
+    uint16_t line;          /* source line, for messages */
+    uint32_t count;         /* repeat / loop count, sleep ms */
+    char     text[CMD_MAX_LEN];
+};
+
+static struct stmt stmts[BATCH_MAX_STMTS];
+static int nstmts;
+
+static int syntax(uint32_t line, const char *why){
+    kprintf("[batch] line %u: %s\n", line, why);
+    return -1;
+}
+
+/* "word <n>[ rest]": the number and where the rest starts */
+static const char* keyword(const char *s, const char *word, uint32_t *n){
+    size_t l = shell_strlen(word);
+    if(!shell_starts(s, word) || (s[l] != ' ' && s[l] != 0)) return 0;
+    const char *p = shell_parse_uint(s + l, n);
+    if(!p) return s;            /* keyword without a count: caller reports it */
+    while(*p == ' ') p++;
+    return p;
+}
+
+static int add_stmt(const char *s, uint32_t line, int *stack, int *depth){
+    if(nstmts == BATCH_MAX_STMTS) return syntax(line, "too many statements");
+    struct stmt *st = &stmts[nstmts];
+    const char *rest;
+    uint32_t n = 0;
+    st->line = (uint16_t)line;
+    st->text[0] = 0;
+
+    if((rest = keyword(s, "repeat", &n))){
+        if(rest == s || !*rest) return syntax(line, "usage: repeat <n> <command>");
+        st->kind = ST_REPEAT; s = rest;
+    } else if((rest = keyword(s, "sleep", &n))){
+        if(rest == s || *rest) return syntax(line, "usage: sleep <ms>");
+        st->kind = ST_SLEEP; s = "";
+    } else if((rest = keyword(s, "loop", &n))){
+        if(rest == s || *rest) return syntax(line, "usage: loop <n>");
+        if(*depth == BATCH_DEPTH) return syntax(line, "loops nested too deep");
+        stack[(*depth)++] = nstmts;
+        st->kind = ST_LOOP; s = "";
+    } else if(shell_streq(s, "end")){
+        if(*depth == 0) return syntax(line, "`end` without `loop`");
+        stmts[stack[--(*depth)]].match = (uint16_t)nstmts;
+        st->kind = ST_END; s = "";
+    } else {
+        st->kind = ST_CMD;
+    }
+    st->count = n;
+
+    size_t l = shell_strlen(s);
+    if(l >= CMD_MAX_LEN) return syntax(line, "command too long");
+    for(size_t i=0;i<=l;i++) st->text[i] = s[i];
+    nstmts++;
+    return 0;
+}
+
+static int parse(const char *script, uint32_t len){
+    char buf[CMD_MAX_LEN + 1];
+    int stack[BATCH_DEPTH], depth = 0;
+    uint32_t line = 1, n = 0;
+    nstmts = 0;
+
+    for(uint32_t i=0;i<=len;i++){
+        char c = i < len ? script[i] : '\n';
+        if(c == 0) c = '\n';
+        if(c != '\n' && c != ';'){
+            if(c == '\r' || c == '\t') c = ' ';
+            if(n < sizeof(buf) - 1) buf[n++] = c;
+            continue;
+        }
+        while(n && buf[n-1] == ' ') n--;
+        buf[n] = 0;
+        const char *s = buf;
+        while(*s == ' ') s++;
+        if(*s && *s != '#' && add_stmt(s, line, stack, &depth)) return -1;
+        n = 0;
+        if(c == '\n') line++;
+        if(i < len && script[i] == 0) break;
+    }
+    if(depth) return syntax(stmts[stack[depth-1]].line, "`loop` without `end`");
+    return 0;
+}
+
+static uint32_t time_cmd(const char *cmd, const struct batch_ops *ops){
+    uint64_t t0 = rdtsc();
+    ops->exec(cmd);
+    return (uint32_t)tsc_to_us(rdtsc() - t0);
+}
+
+static uint32_t run_range(int from, int to, const struct batch_ops *ops){
+    uint32_t cmds = 0;
+    for(int i=from;i<to;i++){
+        const struct stmt *st = &stmts[i];
+        switch(st->kind){
+        case ST_CMD:
+            kprintf("[batch] %s: %u us\n", st->text, time_cmd(st->text, ops));
+            cmds++;
+            break;
+        case ST_REPEAT: {
+            if(!st->count) break;
+            uint32_t mn = 0xFFFFFFFFu, mx = 0;
+            uint64_t sum = 0;
+            for(uint32_t k=0;k<st->count;k++){
+                uint32_t us = time_cmd(st->text, ops);
+                if(us < mn) mn = us;
+                if(us > mx) mx = us;
+                sum += us;
+            }
+            kprintf("[batch] %s x%u: min %u avg %u max %u us\n", st->text, st->count,
+                    mn, (uint32_t)div64_32(sum, st->count, 0), mx);
+            cmds += st->count;
+            break;
+        }
+        case ST_SLEEP:
+            ops->sleep_ms(st->count);
+            break;
+        case ST_LOOP:
+            for(uint32_t k=0;k<st->count;k++) cmds += run_range(i + 1, st->match, ops);
+            i = st->match;
+            break;
+        }
+    }
+    return cmds;
+}
+
+int batch_run(const char *script, uint32_t len, const struct batch_ops *ops){
+    if(parse(script, len)) return -1;
+    uint64_t t0 = rdtsc();
+    uint32_t cmds = run_range(0, nstmts, ops);
+    kprintf("[batch] done: %u commands in %u ms\n", cmds,
+            (uint32_t)div64_32(tsc_to_us(rdtsc() - t0), 1000, 0));
+    return (int)cmds;
+}
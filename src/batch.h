@@ -0,0 +1,26 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <stdint.h>
+
+/* Non-interactive shell scripts (`batch=` on the kernel cmdline).
+   Statements are separated by newlines or ';':
+     <command>              run through the shell and timed
+     repeat <n> <command>   run n times; min/avg/max time
+     loop <n> ... end       run the enclosed statements n times
+     sleep <ms>
+     # comment
+   The whole script is parsed before anything runs. */
+
+#define BATCH_MAX_STMTS 128
+#define BATCH_DEPTH     4       /* nested loops */
+
+struct batch_ops {
+    void (*exec)(const char *cmd);
+    void (*sleep_ms)(uint32_t ms);
+};
+
+/* returns the number of commands executed, or -1 after printing a
+   syntax error (then nothing was run) */
+int batch_run(const char *script, uint32_t len, const struct batch_ops *ops);
+
+#endif
@@ -10,6 +10,19 @@ dd MULTIBOOT2_HEADER_MAGIC
 dd MULTIBOOT2_HEADER_ARCH
 dd MULTIBOOT2_HEADER_LEN
 dd MULTIBOOT2_HEADER_CSUM
+
+; framebuffer request (optional: GRUB may still boot us in text mode)
+align 8
+fb_tag_start:
+dw 5
+dw 1
+dd fb_tag_end - fb_tag_start
+dd 1024                   ; width
+dd 768                    ; height
+dd 32                     ; depth
+fb_tag_end:
+
+align 8
 dw 0
 dw 0
 dd 8
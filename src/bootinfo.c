@@ -0,0 +1,211 @@
+#include "bootinfo.h"
+#include "shell.h"
+#include <stdint.h>
+#include <stddef.h>
+
+extern void vga_writeln(const char* s);
+extern void vga_write(const char* s);
+
+#define MBI_COPY_MAX  16384
+#define OPT_BUF_MAX   512
+
+struct mb2_tag { uint32_t type; uint32_t size; } __attribute__((packed));
+struct mb2_tag_mmap { uint32_t type; uint32_t size; uint32_t entry_size; uint32_t entry_version; } __attribute__((packed));
+struct mb2_mmap_entry { uint64_t addr; uint64_t len; uint32_t type; uint32_t reserved; } __attribute__((packed));
+struct mb2_tag_module { uint32_t type; uint32_t size; uint32_t mod_start; uint32_t mod_end; char string[]; } __attribute__((packed));
+struct mb2_tag_basic_mem { uint32_t type; uint32_t size; uint32_t mem_lower; uint32_t mem_upper; } __attribute__((packed));
+struct mb2_tag_fb {
+    uint32_t type; uint32_t size;
+    uint64_t addr; uint32_t pitch; uint32_t width; uint32_t height;
+    uint8_t  bpp; uint8_t fb_type; uint16_t reserved;
+    uint8_t  red_pos, red_size, green_pos, green_size, blue_pos, blue_size;
+} __attribute__((packed));
+
+__attribute__((aligned(8)))
+static uint8_t mbi_copy[MBI_COPY_MAX];
+static char opt_buf[OPT_BUF_MAX];
+static struct bootinfo bi;
+
+/* split the cmdline into key[=value] words; values may be "quoted" */
+static void parse_opts(const char* cmdline){
+    size_t o = 0;
+    const char *p = cmdline;
+    bi.nopts = 0;
+    while(*p){
+        while(*p == ' ') p++;
+        if(!*p) break;
+        if(bi.nopts == BOOTINFO_MAX_OPTS || o + 2 >= OPT_BUF_MAX) break;
+
+        struct bootinfo_opt *opt = &bi.opts[bi.nopts++];
+        opt->key = &opt_buf[o];
+        while(*p && *p != ' ' && *p != '=' && o + 2 < OPT_BUF_MAX) opt_buf[o++] = *p++;
+        opt_buf[o++] = 0;
+
+        opt->value = &opt_buf[o];
+        if(*p == '='){
+            p++;
+            char quote = (*p == '"') ? *p++ : 0;
+            while(*p && (quote ? *p != quote : *p != ' ') && o + 1 < OPT_BUF_MAX) opt_buf[o++] = *p++;
+            if(quote && *p == quote) p++;
+        }
+        opt_buf[o++] = 0;
+        while(*p && *p != ' ') p++;    /* skip anything truncated */
+    }
+}
+
+static void index_mmap(const uint8_t* tagp, const struct mb2_tag_mmap* mt){
+    const uint8_t *entryp = tagp + sizeof(struct mb2_tag_mmap);
+    if(mt->entry_size < sizeof(struct mb2_mmap_entry)) return;
+    while(entryp + mt->entry_size <= tagp + mt->size){
+        const struct mb2_mmap_entry *e = (const struct mb2_mmap_entry*)entryp;
+        if(bi.nmmap < BOOTINFO_MAX_MMAP){
+            bi.mmap[bi.nmmap].addr = e->addr;
+            bi.mmap[bi.nmmap].len  = e->len;
+            bi.mmap[bi.nmmap].type = e->type;
+            bi.nmmap++;
+        }
+        if(e->type == 1) bi.usable_bytes += e->len;
+        entryp += mt->entry_size;
+    }
+}
+
+void bootinfo_init(uint32_t mbi_addr){
+    bi.cmdline = "";
+    bi.loader_name = "";
+    if(mbi_addr == 0) return;
+
+    const uint8_t *src = (const uint8_t*)(uintptr_t)mbi_addr;
+    uint32_t total_size = *(const uint32_t*)src;
+    if(total_size < 8) return;
+    bi.mbi_size = total_size;
+
+    /* copy into .bss so later heap allocations can't clobber it */
+    const uint8_t *base = src;
+    if(total_size <= MBI_COPY_MAX){
+        for(uint32_t i=0;i<total_size;i++) mbi_copy[i] = src[i];
+        base = mbi_copy;
+        bi.copied = 1;
+    }
+
+    const uint8_t *tagp = base + 8;
+    const uint8_t *endp = base + total_size;
+    while(tagp + sizeof(struct mb2_tag) <= endp){
+        const struct mb2_tag *tag = (const struct mb2_tag*)tagp;
+        if(tag->type == MB2_TAG_END || tag->size < 8) break;
+        if(tag->type <= MB2_TAG_MAX && !bi.tags[tag->type]) bi.tags[tag->type] = tag;
+
+        switch(tag->type){
+        case MB2_TAG_CMDLINE:
+            bi.cmdline = (const char*)(tagp + 8);
+            break;
+        case MB2_TAG_LOADER_NAME:
+            bi.loader_name = (const char*)(tagp + 8);
+            break;
+        case MB2_TAG_BASIC_MEM: {
+            const struct mb2_tag_basic_mem *m = (const struct mb2_tag_basic_mem*)tag;
+            bi.mem_lower_kb = m->mem_lower;
+            bi.mem_upper_kb = m->mem_upper;
+            break;
+        }
+        case MB2_TAG_MMAP:
+            index_mmap(tagp, (const struct mb2_tag_mmap*)tag);
+            break;
+        case MB2_TAG_MODULE: {
+            const struct mb2_tag_module *m = (const struct mb2_tag_module*)tag;
+            if(bi.nmodules < BOOTINFO_MAX_MODULES){
+                struct bootinfo_module *mod = &bi.modules[bi.nmodules++];
+                mod->start = m->mod_start;
+                mod->end   = m->mod_end;
+                mod->name  = m->string;
+            }
+            if(m->mod_end > bi.modules_end) bi.modules_end = m->mod_end;
+            break;
+        }
+        case MB2_TAG_FRAMEBUFFER: {
+            const struct mb2_tag_fb *f = (const struct mb2_tag_fb*)tag;
+            bi.has_fb    = 1;
+            bi.fb.addr   = f->addr;
+            bi.fb.pitch  = f->pitch;
+            bi.fb.width  = f->width;
+            bi.fb.height = f->height;
+            bi.fb.bpp    = f->bpp;
+            bi.fb.type   = f->fb_type;
+            if(f->fb_type == 1 && tag->size >= sizeof(struct mb2_tag_fb)){
+                bi.fb.red_pos   = f->red_pos;   bi.fb.red_size   = f->red_size;
+                bi.fb.green_pos = f->green_pos; bi.fb.green_size = f->green_size;
+                bi.fb.blue_pos  = f->blue_pos;  bi.fb.blue_size  = f->blue_size;
+            }
+            break;
+        }
+        case MB2_TAG_ACPI_NEW:
+            bi.rsdp = tagp + 8;
+            bi.rsdp_v2 = 1;
+            break;
+        case MB2_TAG_ACPI_OLD:
+            if(!bi.rsdp) bi.rsdp = tagp + 8;
+            break;
+        }
+        tagp += (tag->size + 7) & ~7;
+    }
+
+    parse_opts(bi.cmdline);
+}
+
+const struct bootinfo* bootinfo_get(void){ return &bi; }
+
+const void* bootinfo_tag(uint32_t type){
+    return type <= MB2_TAG_MAX ? bi.tags[type] : 0;
+}
+
+const char* bootinfo_opt(const char* key){
+    for(uint32_t i=0;i<bi.nopts;i++)
+        if(shell_streq(bi.opts[i].key, key)) return bi.opts[i].value;
+    return 0;
+}
+
+uint32_t bootinfo_opt_uint(const char* key, uint32_t def){
+    const char *v = bootinfo_opt(key);
+    if(!v || *v < '0' || *v > '9') return def;
+    uint32_t x = 0;
+    while(*v >= '0' && *v <= '9') x = x * 10 + (uint32_t)(*v++ - '0');
+    return x;
+}
+
+const struct bootinfo_module* bootinfo_module_find(const char* name){
+    for(uint32_t i=0;i<bi.nmodules;i++)
+        if(shell_streq(bi.modules[i].name, name)) return &bi.modules[i];
+    return 0;
+}
+
+void bootinfo_print(void){
+    char b[16];
+    shell_utoa32(bi.mbi_size, b);
+    vga_write("mbi size="); vga_write(b);
+    vga_writeln(bi.copied ? " (copied)" : " (in place)");
+    vga_write("loader: "); vga_writeln(bi.loader_name);
+    vga_write("cmdline: "); vga_writeln(bi.cmdline);
+    for(uint32_t i=0;i<bi.nopts;i++){
+        vga_write("  opt "); vga_write(bi.opts[i].key);
+        if(bi.opts[i].value[0]){ vga_write(" = "); vga_write(bi.opts[i].value); }
+        vga_writeln("");
+    }
+    shell_utoa32(bi.nmmap, b);
+    vga_write("mmap entries: "); vga_writeln(b);
+    for(uint32_t i=0;i<bi.nmodules;i++){
+        vga_write("module 0x"); shell_hex8(bi.modules[i].start, b); vga_write(b);
+        vga_write("-0x"); shell_hex8(bi.modules[i].end, b); vga_write(b);
+        vga_write(" "); vga_writeln(bi.modules[i].name);
+    }
+    if(bi.has_fb){
+        vga_write("framebuffer 0x"); shell_hex8((uint32_t)bi.fb.addr, b); vga_write(b);
+        shell_utoa32(bi.fb.width, b);  vga_write(" "); vga_write(b);
+        shell_utoa32(bi.fb.height, b); vga_write("x"); vga_write(b);
+        shell_utoa32(bi.fb.bpp, b);    vga_write("x"); vga_write(b);
+        shell_utoa32(bi.fb.type, b);   vga_write(" type="); vga_writeln(b);
+    }
+    if(bi.rsdp){
+        shell_hex8((uint32_t)(uintptr_t)bi.rsdp, b);
+        vga_write("acpi rsdp copy at 0x"); vga_write(b);
+        vga_writeln(bi.rsdp_v2 ? " (v2)" : " (v1)");
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef BOOTINFO_H
+#define BOOTINFO_H
+#include <stdint.h>
+
+/* Multiboot2 boot information, parsed once at boot.
+   bootinfo_init copies the MBI out of loader-owned memory and indexes the
+   tags into typed arrays; everything else reads from here. */
+
+#define MB2_TAG_END          0
+#define MB2_TAG_CMDLINE      1
+#define MB2_TAG_LOADER_NAME  2
+#define MB2_TAG_MODULE       3
+#define MB2_TAG_BASIC_MEM    4
+#define MB2_TAG_MMAP         6
+#define MB2_TAG_FRAMEBUFFER  8
+#define MB2_TAG_ACPI_OLD     14
+#define MB2_TAG_ACPI_NEW     15
+#define MB2_TAG_MAX          24
+
+#define BOOTINFO_MAX_MMAP    64
+#define BOOTINFO_MAX_MODULES 16
+#define BOOTINFO_MAX_OPTS    24
+
+struct bootinfo_mmap {
+    uint64_t addr;
+    uint64_t len;
+    uint32_t type;          /* 1 = usable */
+};
+
+struct bootinfo_module {
+    uint32_t    start;
+    uint32_t    end;        /* exclusive */
+    const char *name;       /* module string from grub.cfg */
+};
+
+struct bootinfo_fb {
+    uint64_t addr;
+    uint32_t pitch;
+    uint32_t width;
+    uint32_t height;
+    uint8_t  bpp;
+    uint8_t  type;          /* 0 = indexed, 1 = RGB, 2 = EGA text */
+    uint8_t  red_pos, red_size;
+    uint8_t  green_pos, green_size;
+    uint8_t  blue_pos, blue_size;
+};
+
+struct bootinfo_opt {
+    const char *key;
+    const char *value;      /* "" for bare flags like `quiet` */
+};
+
+struct bootinfo {
+    uint32_t    mbi_size;
+    int         copied;                     /* 0 if the MBI was too big to copy */
+    const char *cmdline;
+    const char *loader_name;
+
+    uint32_t    mem_lower_kb, mem_upper_kb;
+
+    uint32_t    nmmap;
+    struct bootinfo_mmap mmap[BOOTINFO_MAX_MMAP];
+    uint64_t    usable_bytes;
+
+    uint32_t    nmodules;
+    struct bootinfo_module modules[BOOTINFO_MAX_MODULES];
+    uint32_t    modules_end;                /* highest module end address */
+
+    int         has_fb;
+    struct bootinfo_fb fb;
+
+    const void *rsdp;                       /* ACPI RSDP copy, or 0 */
+    int         rsdp_v2;
+
+    uint32_t    nopts;
+    struct bootinfo_opt opts[BOOTINFO_MAX_OPTS];
+
+    const void *tags[MB2_TAG_MAX + 1];      /* first tag of each type */
+};
+
+void bootinfo_init(uint32_t mbi_addr);
+const struct bootinfo* bootinfo_get(void);
+
+/* raw tag lookup (first tag of that type) */
+const void* bootinfo_tag(uint32_t type);
+
+/* kernel cmdline options: `key=value` or bare `key` */
+const char* bootinfo_opt(const char* key);                 /* 0 if absent */
+uint32_t    bootinfo_opt_uint(const char* key, uint32_t def);
+
+const struct bootinfo_module* bootinfo_module_find(const char* name);
+
+void bootinfo_print(void);
+
+#endif
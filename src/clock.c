@@ -0,0 +1,178 @@
+#include "clock.h"
+#include "rtc.h"
+#include "tsc.h"
+#include "irq.h"
+#include "io.h"
+#include "workq.h"
+#include "math64.h"
+#include "klog.h"
+#include "shell.h"
+#include "bootinfo.h"
+#include <stdint.h>
+
+#define RTC_IRQ         8
+#define RTC_VECTOR      (0x20 + RTC_IRQ)
+#define NS_PER_SEC      1000000000ull
+#define SYNC_DEFAULT    60
+
+/* time = base_ns + time since base_tsc (base_ticks without a TSC).
+   `seq` is odd while the base changes; readers retry across it. */
+static volatile uint32_t seq;
+static uint64_t base_ns, base_tsc;
+static uint32_t base_ticks;
+static uint32_t khz;                    /* own copy, refined by resyncs */
+
+static uint32_t sync_every;             /* seconds; 0 = no IRQ8 */
+static volatile uint32_t since_sync;
+static volatile uint64_t edge_tsc;      /* TSC at the IRQ8 being handled */
+static uint64_t last_edge_tsc;
+static uint32_t last_edge_secs;
+static uint32_t syncs;
+static int32_t  last_err_us;
+static uint32_t max_err_us;
+
+/* cycles * 1e6 / khz, split to keep the product in 64 bits */
+static uint64_t cyc_to_ns(uint64_t c, uint32_t k){
+    uint32_t rem;
+    uint64_t q = div64_32(c, k, &rem);
+    return q * 1000000u + div64_32((uint64_t)rem * 1000000u, k, 0);
+}
+
+static uint64_t elapsed_ns(uint64_t tsc){
+    if(khz) return cyc_to_ns(tsc - base_tsc, khz);
+    return (uint64_t)(timer_ticks() - base_ticks) * (1000000000u / timer_hz());
+}
+
+uint64_t time_now(void){
+    uint32_t s;
+    uint64_t ns;
+    do {
+        s = seq;
+        __asm__ volatile("" ::: "memory");
+        ns = base_ns + elapsed_ns(rdtsc());
+        __asm__ volatile("" ::: "memory");
+    } while((s & 1) || s != seq);
+    return ns;
+}
+
+/* the rate is part of the base: a reader must never pair a new khz with
+   the old base_tsc */
+static void set_base(uint64_t ns, uint64_t tsc, uint32_t k){
+    uint32_t f = irq_save();
+    seq++;
+    __asm__ volatile("" ::: "memory");
+    base_ns = ns;
+    base_tsc = tsc;
+    khz = k;
+    base_ticks = timer_ticks();
+    __asm__ volatile("" ::: "memory");
+    seq++;
+    irq_restore(f);
+}
+
+/* Softirq right after the RTC advanced, so the read cannot hit an update
+   and the new second began at edge_tsc (plus IRQ latency). */
+static void rtc_bottom(uint32_t arg){
+    (void)arg;
+    struct rtc_time t;
+    rtc_read(&t);
+    uint32_t secs = rtc_to_unix(&t);
+    uint64_t edge = edge_tsc;
+
+    /* cycles between two second edges give the TSC rate directly */
+    uint32_t k = khz;
+    if(k && syncs && secs > last_edge_secs)
+        k = (uint32_t)div64_32(edge - last_edge_tsc, (secs - last_edge_secs) * 1000u, 0);
+
+    uint64_t rtc_ns = (uint64_t)secs * NS_PER_SEC;
+    uint64_t clk_ns = base_ns + elapsed_ns(edge);
+    uint32_t a = (uint32_t)div64_32(rtc_ns >= clk_ns ? rtc_ns - clk_ns : clk_ns - rtc_ns, 1000, 0);
+    last_err_us = rtc_ns >= clk_ns ? (int32_t)a : -(int32_t)a;
+    if(syncs && a > max_err_us) max_err_us = a;     /* the first sync fixes the boot phase */
+
+    set_base(rtc_ns, edge, k);
+    last_edge_tsc = edge;
+    last_edge_secs = secs;
+    syncs++;
+}
+
+void rtc_isr(void){
+    uint64_t now = rdtsc();
+    uint8_t c = rtc_ack();
+    irq_eoi(RTC_IRQ);
+    if((c & RTC_UF) && ++since_sync >= sync_every){
+        since_sync = 0;
+        edge_tsc = now;
+        workq_queue(WQ_RTC, rtc_bottom, 0);
+    }
+    workq_run_irq_exit();
+}
+
+__attribute__((naked)) void rtc_irq_stub(void){
+    __asm__ volatile(
+        "pusha\n"
+        "incl irq_total\n"
+        "call rtc_isr\n"
+        "popa\n"
+        "iret\n"
+    );
+}
+
+void clock_init(void){
+    struct rtc_time t;
+    rtc_read(&t);
+    /* the read lands somewhere inside the second: up to 1 s behind until
+       the first resync */
+    set_base((uint64_t)rtc_to_unix(&t) * NS_PER_SEC, rdtsc(), tsc_khz());
+
+    const char *opt = bootinfo_opt("rtcsync");
+    if(!opt) return;
+    sync_every = SYNC_DEFAULT;
+    if(opt[0]) shell_parse_uint(opt, &sync_every);
+    if(!sync_every) return;
+    since_sync = sync_every;                /* anchor on the first edge */
+    irq_set_gate(RTC_VECTOR, rtc_irq_stub, IDT_GATE_INT);
+    rtc_uie_set(1);
+    irq_unmask(RTC_IRQ);
+}
+
+static void print_time(uint64_t ns){
+    uint32_t rem;
+    uint64_t secs = div64_32(ns, 1000000000u, &rem);
+    struct rtc_time t;
+    rtc_from_unix((uint32_t)secs, &t);
+    kprintf("%02u:%02u:%02u.%06u  Date: %u/%u/%u", t.hour, t.min, t.sec, rem / 1000u,
+            t.day, t.month, t.year);
+}
+
+void clock_print(void){
+    uint64_t t0 = rdtsc();
+    uint64_t now = time_now();
+    uint32_t cost = (uint32_t)(rdtsc() - t0);
+
+    kprintf("Time: ");
+    print_time(now);
+    kprintf("\n");
+    if(khz) kprintf("clock: TSC at %u kHz, time_now() %u cycles\n", khz, cost);
+    else    kprintf("clock: %u Hz ticks (no usable TSC)\n", timer_hz());
+    if(sync_every)
+        kprintf("rtc resync every %u s: %u syncs, last error %d us, max |error| %u us\n",
+                sync_every, syncs, last_err_us, max_err_us);
+    else
+        kprintf("rtc resync off (boot with rtcsync=<seconds>)\n");
+}
+
+void clock_rtc_compare(void){
+    struct rtc_time t;
+    uint64_t t0 = rdtsc();
+    rtc_read(&t);
+    uint32_t us = (uint32_t)tsc_to_us(rdtsc() - t0);
+    uint64_t now = time_now();
+    int32_t diff = (int32_t)rtc_to_unix(&t) - (int32_t)div64_32(now, 1000000000u, 0);
+
+    kprintf("RTC:   %02u:%02u:%02u  Date: %u/%u/%u (read took %u us)\n",
+            t.hour, t.min, t.sec, t.day, t.month, t.year, us);
+    kprintf("clock: ");
+    print_time(now);
+    kprintf("\nRTC - clock: %d s (RTC has 1 s resolution)\n", diff);
+}
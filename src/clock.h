@@ -0,0 +1,20 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+#include <stdint.h>
+
+/* Wall clock. The RTC is read once at boot; after that the time is the
+   boot value plus TSC cycles (timer ticks if the TSC is unusable). With
+   `rtcsync=<s>` on the cmdline (bare `rtcsync`: 60) the RTC update-ended
+   interrupt re-anchors the clock every <s> seconds on an exact second
+   edge and re-measures the TSC rate against it. */
+
+void clock_init(void);          /* after irq_select_intc */
+
+/* nanoseconds since 1970-01-01 in RTC time (local time under QEMU's
+   -rtc base=localtime); no port I/O, safe from IRQ context */
+uint64_t time_now(void);
+
+void clock_print(void);         /* `time` */
+void clock_rtc_compare(void);   /* `time rtc`: fresh RTC read vs time_now() */
+
+#endif
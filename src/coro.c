@@ -0,0 +1,298 @@
+#include "coro.h"
+#include "task.h"
+#include "irq.h"
+#include "io.h"
+#include "kalloc.h"
+#include "klog.h"
+#include "tsc.h"
+#include "math64.h"
+#include <stdint.h>
+
+/* Timers hash into a wheel by wake tick; coro_run only visits the buckets
+   of the ticks that passed since the previous run, so parking and waking
+   are O(1) per coroutine (plus later laps sharing a bucket). */
+#define CORO_WHEEL 64       /* power of two */
+
+static struct coro *ready_head, *ready_tail;
+static struct coro *wheel[CORO_WHEEL];
+static uint32_t wheel_tick;             /* every tick up to this one has been expired */
+static struct coro *kbd_head;
+static uint32_t live, ntimers, nkbd, started, resumes;
+
+/* written by the keyboard bottom half */
+static volatile uint32_t key_seq;
+static volatile char last_key;
+static uint32_t key_seen;               /* key_seq when key waiters were last woken */
+
+static volatile int sched_id = -1, sched_waiting;
+
+static void ready_push(struct coro *c){
+    c->state = CORO_S_READY;
+    c->next = 0;
+    if(ready_tail) ready_tail->next = c;
+    else ready_head = c;
+    ready_tail = c;
+}
+
+static void sched_kick(void){
+    if(sched_waiting) task_wake(sched_id);
+}
+
+void coro_start(struct coro *c, int (*fn)(struct coro *c), void *arg){
+    c->fn = fn;
+    c->arg = arg;
+    c->lc = 0;
+    c->i = 0;
+    c->key = 0;
+    live++;
+    started++;
+    ready_push(c);
+    sched_kick();
+}
+
+void coro_wait_ticks(struct coro *c, uint32_t ticks){
+    c->state = CORO_S_TIMER;
+    c->wake = timer_ticks() + ticks;
+}
+
+void coro_wait_key(struct coro *c){
+    c->state = CORO_S_KBD;
+    c->wake = key_seq;
+}
+
+/* file a coroutine that returned CORO_WAITING */
+static void park(struct coro *c){
+    if(c->state == CORO_S_KBD){
+        c->next = kbd_head;
+        kbd_head = c;
+        nkbd++;
+    } else if((int32_t)(c->wake - wheel_tick) <= 0){
+        ready_push(c);                  /* its bucket was already expired */
+    } else {
+        struct coro **b = &wheel[c->wake & (CORO_WHEEL - 1)];
+        c->next = *b;
+        *b = c;
+        ntimers++;
+    }
+}
+
+static void timers_expire(uint32_t now){
+    uint32_t steps = now - wheel_tick;
+    if(ntimers && (int32_t)steps > 0){
+        if(steps > CORO_WHEEL) steps = CORO_WHEEL;
+        for(uint32_t t = wheel_tick + 1; t != wheel_tick + 1 + steps; t++){
+            struct coro **pp = &wheel[t & (CORO_WHEEL - 1)];
+            while(*pp){
+                struct coro *c = *pp;
+                if((int32_t)(now - c->wake) >= 0){
+                    *pp = c->next;
+                    ntimers--;
+                    ready_push(c);
+                } else pp = &c->next;
+            }
+        }
+    }
+    if((int32_t)(now - wheel_tick) > 0) wheel_tick = now;
+}
+
+static void keys_wake(void){
+    uint32_t f = irq_save();
+    uint32_t seq = key_seq;
+    char k = last_key;
+    irq_restore(f);
+    if(seq == key_seen) return;
+    key_seen = seq;
+
+    struct coro **pp = &kbd_head;
+    while(*pp){
+        struct coro *c = *pp;
+        if(c->wake != seq){
+            *pp = c->next;
+            nkbd--;
+            c->key = k;
+            ready_push(c);
+        } else pp = &c->next;
+    }
+}
+
+uint32_t coro_run(void){
+    timers_expire(timer_ticks());
+    keys_wake();
+
+    /* one pass: coroutines that yield go to the back for the next run */
+    struct coro *c = ready_head;
+    ready_head = ready_tail = 0;
+    uint32_t n = 0;
+    while(c){
+        struct coro *next = c->next;
+        int r = c->fn(c);
+        n++;
+        if(r == CORO_YIELDED) ready_push(c);
+        else if(r == CORO_WAITING) park(c);
+        else { c->state = CORO_S_DONE; live--; }
+        c = next;
+    }
+    resumes += n;
+    return n;
+}
+
+/* Ticks until the earliest timer (0 if one is due or the wheel is behind),
+   -1 without timers. Scans forward from wheel_tick to the first bucket
+   holding a timer due in this lap, so the cost is bounded by one lap
+   rather than the number of timers; if only later laps are parked it
+   answers CORO_WHEEL and corod simply looks again then. */
+static int32_t next_deadline(uint32_t now){
+    if(!ntimers) return -1;
+    if(now != wheel_tick) return 0;
+    for(uint32_t d=1; d<=CORO_WHEEL; d++){
+        uint32_t t = wheel_tick + d;
+        for(struct coro *c = wheel[t & (CORO_WHEEL - 1)]; c; c = c->next)
+            if(c->wake == t) return (int32_t)d;
+    }
+    return CORO_WHEEL;
+}
+
+void coro_sched(void *arg){
+    (void)arg;
+    sched_id = task_current_id();
+    for(;;){
+        coro_run();
+        if(ready_head){ task_yield(); continue; }
+
+        uint32_t f = irq_save();
+        int32_t until = next_deadline(timer_ticks());
+        if(!ready_head && key_seq == key_seen && until != 0){
+            sched_waiting = 1;
+            if(until > 0) task_sleep((uint32_t)until);
+            else task_block();
+            sched_waiting = 0;
+        }
+        irq_restore(f);
+    }
+}
+
+void coro_key_event(char c){
+    last_key = c;
+    key_seq++;
+    sched_kick();
+}
+
+void coro_get_stats(struct coro_stats *s){
+    uint32_t nready = 0;
+    for(struct coro *c = ready_head; c; c = c->next) nready++;
+    s->live    = live;
+    s->ready   = nready;
+    s->timers  = ntimers;
+    s->kbd     = nkbd;
+    s->started = started;
+    s->resumes = resumes;
+}
+
+void coro_stats_print(void){
+    struct coro_stats s;
+    coro_get_stats(&s);
+    kprintf("coroutines: %u live (%u ready, %u sleeping, %u awaiting a key), %u bytes each\n",
+            s.live, s.ready, s.timers, s.kbd, (uint32_t)sizeof(struct coro));
+    kprintf("%u started, %u resumes since boot\n", s.started, s.resumes);
+}
+
+/* ---- `coro demo` ---- */
+
+static struct coro demo_tick, demo_keys;
+
+static int demo_tick_fn(struct coro *c){
+    CORO_BEGIN(c);
+    for(c->i = 1; c->i <= 5; c->i++){
+        CORO_SLEEP(c, timer_hz());
+        klog(KLOG_INFO, "[coro] tick %u", c->i);
+    }
+    CORO_END(c);
+}
+
+static int demo_keys_fn(struct coro *c){
+    CORO_BEGIN(c);
+    for(c->i = 1; c->i <= 3; c->i++){
+        CORO_AWAIT_KEY(c);
+        klog(KLOG_INFO, "[coro] key %u: 0x%x", c->i, (uint32_t)(uint8_t)c->key);
+    }
+    CORO_END(c);
+}
+
+void coro_demo(void){
+    struct coro *d[2] = { &demo_tick, &demo_keys };
+    for(int i=0;i<2;i++)
+        if(d[i]->state != CORO_S_IDLE && !coro_done(d[i])){
+            kprintf("coro demo: still running\n");
+            return;
+        }
+    coro_start(&demo_tick, demo_tick_fn, 0);
+    coro_start(&demo_keys, demo_keys_fn, 0);
+    kprintf("coro demo: a tick every second for 5 s, and the next 3 key presses\n");
+}
+
+/* ---- `corobench` ---- */
+
+#define CORO_BENCH_N      1000
+#define CORO_BENCH_TASKS  4
+#define CORO_BENCH_ROUNDS 50
+
+static struct coro bench_co[CORO_BENCH_N];
+static volatile uint32_t bench_tasks_left;
+
+static int bench_fn(struct coro *c){
+    CORO_BEGIN(c);
+    for(c->i = 0; c->i < CORO_BENCH_ROUNDS; c->i++) CORO_YIELD(c);
+    CORO_END(c);
+}
+
+static void bench_task(void *arg){
+    (void)arg;
+    for(int i=0;i<CORO_BENCH_ROUNDS;i++) task_yield();
+    bench_tasks_left--;
+}
+
+static uint32_t per(uint64_t total, uint32_t n){
+    return n ? (uint32_t)div64_32(total, n, 0) : 0;
+}
+
+void coro_bench(void){
+    for(int i=0;i<CORO_BENCH_N;i++)
+        if(bench_co[i].state != CORO_S_IDLE && !coro_done(&bench_co[i])){
+            kprintf("corobench: already running\n");
+            return;
+        }
+
+    /* coroutines: spawn all, then run the ready queue from here until done */
+    uint64_t t0 = rdtsc();
+    for(int i=0;i<CORO_BENCH_N;i++) coro_start(&bench_co[i], bench_fn, 0);
+    uint64_t c_spawn = rdtsc() - t0;
+    uint32_t r0 = resumes;
+    t0 = rdtsc();
+    while(!coro_done(&bench_co[CORO_BENCH_N - 1])) coro_run();
+    uint64_t c_run = rdtsc() - t0;
+    uint32_t c_switches = resumes - r0;
+
+    /* tasks: their stacks and TCBs stay allocated (the heap cannot free) */
+    uint32_t m0 = kalloc_bytes_used();
+    uint32_t n = 0;
+    bench_tasks_left = CORO_BENCH_TASKS;
+    t0 = rdtsc();
+    for(int i=0;i<CORO_BENCH_TASKS;i++)
+        if(task_create_ex(&(struct task_attrs){ .name = "corobench", .entry = bench_task }) >= 0) n++;
+    uint64_t t_spawn = rdtsc() - t0;
+    uint32_t t_mem = kalloc_bytes_used() - m0;
+    bench_tasks_left -= CORO_BENCH_TASKS - n;
+    uint32_t s0 = task_switch_count();
+    t0 = rdtsc();
+    while(bench_tasks_left) task_yield();
+    uint64_t t_run = rdtsc() - t0;
+    uint32_t t_switches = task_switch_count() - s0;
+
+    kprintf("corobench: %u coroutines and %u tasks, %u yields each\n",
+            CORO_BENCH_N, n, CORO_BENCH_ROUNDS);
+    kprintf("             spawn cycles  switch cycles  bytes each\n");
+    kprintf("  coroutine  %12u  %13u  %10u\n",
+            per(c_spawn, CORO_BENCH_N), per(c_run, c_switches), (uint32_t)sizeof(struct coro));
+    kprintf("  task       %12u  %13u  %10u\n",
+            per(t_spawn, n), per(t_run, t_switches), n ? t_mem / n : 0);
+}
@@ -0,0 +1,101 @@
+#ifndef CORO_H
+#define CORO_H
+#include <stdint.h>
+
+/* Stackless coroutines (protothreads) run by a single `corod` task.
+
+   A coroutine is a function that is called again from the top on every
+   resume; CORO_BEGIN jumps to the line it last suspended at (a switch on
+   __LINE__). Locals do not survive a suspension: keep state in `i` or in
+   whatever `arg` points to. Put at most one suspension per source line and
+   do not suspend from inside another switch statement.
+
+       static int blink(struct coro *c){
+           CORO_BEGIN(c);
+           for(c->i = 0; c->i < 10; c->i++){
+               toggle();
+               CORO_SLEEP(c, 50);
+           }
+           CORO_END(c);
+       }
+
+   The caller owns the struct coro (static, in another object, or from
+   kmalloc); it may be reused once coro_done() is true. Coroutines must
+   not call task_yield/task_sleep themselves - that would stall every
+   other coroutine. */
+
+struct coro {
+    struct coro *next;              /* ready / timer / keyboard list link */
+    int        (*fn)(struct coro *c);
+    void        *arg;
+    uint32_t     wake;              /* tick to wake at, or the key sequence waited on */
+    uint32_t     i;                 /* free for the coroutine, kept across suspensions */
+    uint16_t     lc;                /* resume line, 0 = start */
+    uint8_t      state;
+    char         key;               /* key that ended the last CORO_AWAIT_KEY */
+};
+
+#define CORO_S_IDLE   0             /* never started */
+#define CORO_S_READY  1
+#define CORO_S_TIMER  2
+#define CORO_S_KBD    3
+#define CORO_S_DONE   4
+
+/* return values of a coroutine function (produced by the macros) */
+#define CORO_EXITED   0
+#define CORO_YIELDED  1
+#define CORO_WAITING  2
+
+#define CORO_BEGIN(c)   switch((c)->lc){ case 0:
+#define CORO_END(c)     } (c)->lc = 0; return CORO_EXITED
+
+/* let every other ready coroutine run once */
+#define CORO_YIELD(c) \
+    do { (c)->lc = __LINE__; return CORO_YIELDED; case __LINE__:; } while(0)
+
+/* resume no earlier than `ticks` timer ticks from now */
+#define CORO_SLEEP(c, ticks) \
+    do { coro_wait_ticks((c), (ticks)); (c)->lc = __LINE__; return CORO_WAITING; case __LINE__:; } while(0)
+
+/* resume at the next key press; the character is left in (c)->key */
+#define CORO_AWAIT_KEY(c) \
+    do { coro_wait_key(c); (c)->lc = __LINE__; return CORO_WAITING; case __LINE__:; } while(0)
+
+/* finish now */
+#define CORO_EXIT(c)    do { (c)->lc = 0; return CORO_EXITED; } while(0)
+
+/* initialise `c` and put it on the ready queue (task context only) */
+void coro_start(struct coro *c, int (*fn)(struct coro *c), void *arg);
+static inline int coro_done(const struct coro *c){ return c->state == CORO_S_DONE; }
+
+/* used by the macros */
+void coro_wait_ticks(struct coro *c, uint32_t ticks);
+void coro_wait_key(struct coro *c);
+
+/* Wake expired timers and key waiters, then resume every ready coroutine
+   once. Returns the number resumed. Called by corod; the benchmark calls
+   it directly from the shell. */
+uint32_t coro_run(void);
+
+/* corod entry point (create with task_create_ex); sleeps until the next
+   timer deadline or key press when nothing is ready */
+void coro_sched(void *arg);
+
+/* keyboard bottom half hook: one decoded key press (IRQ-safe) */
+void coro_key_event(char c);
+
+struct coro_stats {
+    uint32_t live, ready, timers, kbd;  /* coroutines in each state */
+    uint32_t started, resumes;
+};
+void coro_get_stats(struct coro_stats *s);
+void coro_stats_print(void);
+
+/* `coro demo`: a once-a-second ticker and a key-press listener, via klog */
+void coro_demo(void);
+
+/* `corobench`: spawn and switch cost and memory per activity, coroutines
+   against task_create_ex/task_yield */
+void coro_bench(void);
+
+#endif
@@ -0,0 +1,46 @@
+#include "elf.h"
+
+static const struct elf32_ehdr* ehdr(const void *img){
+    return (const struct elf32_ehdr*)img;
+}
+
+const struct elf32_phdr* elf_phdr(const void *img, int i){
+    const uint8_t *p = (const uint8_t*)img;
+    return (const struct elf32_phdr*)(p + ehdr(img)->e_phoff + (uint32_t)i * sizeof(struct elf32_phdr));
+}
+
+static int fail(const char **err, const char *why){
+    if(err) *err = why;
+    return -1;
+}
+
+int elf_check(const void *img, uint32_t len, uint32_t lo, uint32_t hi, const char **err){
+    const struct elf32_ehdr *h = ehdr(img);
+    if(len < sizeof(*h)) return fail(err, "truncated header");
+    if(h->e_ident[0] != 0x7F || h->e_ident[1] != 'E' || h->e_ident[2] != 'L' || h->e_ident[3] != 'F')
+        return fail(err, "not an ELF file");
+    if(h->e_ident[4] != ELFCLASS32 || h->e_ident[5] != ELFDATA2LSB)
+        return fail(err, "not ELF32 little-endian");
+    if(h->e_type != ET_EXEC) return fail(err, "not an executable");
+    if(h->e_machine != EM_386) return fail(err, "not i386");
+    if(h->e_phentsize != sizeof(struct elf32_phdr)) return fail(err, "bad phentsize");
+    if(h->e_phnum == 0 || h->e_phnum > ELF_MAX_PHDRS) return fail(err, "bad phnum");
+    if((uint64_t)h->e_phoff + (uint64_t)h->e_phnum * sizeof(struct elf32_phdr) > len)
+        return fail(err, "program headers past end of file");
+
+    int loads = 0, entry_ok = 0;
+    for(int i=0;i<h->e_phnum;i++){
+        const struct elf32_phdr *ph = elf_phdr(img, i);
+        if(ph->p_type != PT_LOAD) continue;
+        loads++;
+        if(ph->p_filesz > ph->p_memsz) return fail(err, "filesz > memsz");
+        if((uint64_t)ph->p_offset + ph->p_filesz > len) return fail(err, "segment past end of file");
+        if(ph->p_vaddr < lo || (uint64_t)ph->p_vaddr + ph->p_memsz > hi)
+            return fail(err, "segment outside user range");
+        if((ph->p_flags & PF_X) && h->e_entry >= ph->p_vaddr && h->e_entry < ph->p_vaddr + ph->p_memsz)
+            entry_ok = 1;
+    }
+    if(!loads) return fail(err, "no PT_LOAD segments");
+    if(!entry_ok) return fail(err, "entry not in an executable segment");
+    return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef ELF_H
+#define ELF_H
+
+#include <stdint.h>
+
+/* ELF32 (System V gABI) structures: only what the program loader needs */
+
+#define EI_NIDENT    16
+#define ELFCLASS32   1
+#define ELFDATA2LSB  1
+#define ET_EXEC      2
+#define EM_386       3
+
+#define PT_LOAD      1
+
+#define PF_X         1
+#define PF_W         2
+#define PF_R         4
+
+#define ELF_MAX_PHDRS 16
+
+struct elf32_ehdr {
+    uint8_t  e_ident[EI_NIDENT];
+    uint16_t e_type, e_machine;
+    uint32_t e_version, e_entry, e_phoff, e_shoff, e_flags;
+    uint16_t e_ehsize, e_phentsize, e_phnum, e_shentsize, e_shnum, e_shstrndx;
+};
+
+struct elf32_phdr {
+    uint32_t p_type, p_offset, p_vaddr, p_paddr;
+    uint32_t p_filesz, p_memsz, p_flags, p_align;
+};
+
+/* Validate an executable image of `len` bytes: 32-bit little-endian i386
+   ET_EXEC, program headers inside the image, every PT_LOAD's file range
+   inside the image and its memory range inside [lo, hi), entry inside an
+   executable segment. Returns 0, or -1 with *err set to a reason. */
+int elf_check(const void *img, uint32_t len, uint32_t lo, uint32_t hi, const char **err);
+
+/* program header `i` of an image that passed elf_check */
+const struct elf32_phdr* elf_phdr(const void *img, int i);
+
+#endif
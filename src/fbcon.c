@@ -0,0 +1,320 @@
+#include "fbcon.h"
+#include "bootinfo.h"
+#include "kalloc.h"
+#include "paging.h"
+#include "shell.h"
+#include <stdint.h>
+#include <stddef.h>
+
+extern void vga_writeln(const char* s);
+extern void vga_write(const char* s);
+
+/* ASCII 32..126; 5x7 glyphs with doubled rows, 1 px padding */
+static const uint8_t font8x16[95][16] = {
+    { 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00 }, /* ' ' */
+    { 0x00,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x00,0x00,0x10,0x10,0x00 }, /* '!' */
+    { 0x00,0x28,0x28,0x28,0x28,0x28,0x28,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00 }, /* '"' */
+    { 0x00,0x28,0x28,0x28,0x28,0x7C,0x7C,0x28,0x28,0x7C,0x7C,0x28,0x28,0x28,0x28,0x00 }, /* '#' */
+    { 0x00,0x10,0x10,0x3C,0x3C,0x50,0x50,0x38,0x38,0x14,0x14,0x78,0x78,0x10,0x10,0x00 }, /* '$' */
+    { 0x00,0x60,0x60,0x64,0x64,0x08,0x08,0x10,0x10,0x20,0x20,0x4C,0x4C,0x0C,0x0C,0x00 }, /* '%' */
+    { 0x00,0x30,0x30,0x48,0x48,0x50,0x50,0x20,0x20,0x54,0x54,0x48,0x48,0x34,0x34,0x00 }, /* '&' */
+    { 0x00,0x10,0x10,0x10,0x10,0x20,0x20,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00 }, /* '\'' */
+    { 0x00,0x08,0x08,0x10,0x10,0x20,0x20,0x20,0x20,0x20,0x20,0x10,0x10,0x08,0x08,0x00 }, /* '(' */
+    { 0x00,0x20,0x20,0x10,0x10,0x08,0x08,0x08,0x08,0x08,0x08,0x10,0x10,0x20,0x20,0x00 }, /* ')' */
+    { 0x00,0x00,0x00,0x10,0x10,0x54,0x54,0x38,0x38,0x54,0x54,0x10,0x10,0x00,0x00,0x00 }, /* '*' */
+    { 0x00,0x00,0x00,0x10,0x10,0x10,0x10,0x7C,0x7C,0x10,0x10,0x10,0x10,0x00,0x00,0x00 }, /* '+' */
+    { 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x30,0x30,0x10,0x10,0x20,0x20,0x00 }, /* ',' */
+    { 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7C,0x7C,0x00,0x00,0x00,0x00,0x00,0x00,0x00 }, /* '-' */
+    { 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x30,0x30,0x30,0x30,0x00 }, /* '.' */
+    { 0x00,0x00,0x00,0x04,0x04,0x08,0x08,0x10,0x10,0x20,0x20,0x40,0x40,0x00,0x00,0x00 }, /* slash */
+    { 0x00,0x38,0x38,0x44,0x44,0x4C,0x4C,0x54,0x54,0x64,0x64,0x44,0x44,0x38,0x38,0x00 }, /* '0' */
+    { 0x00,0x10,0x10,0x30,0x30,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x38,0x38,0x00 }, /* '1' */
+    { 0x00,0x38,0x38,0x44,0x44,0x04,0x04,0x08,0x08,0x10,0x10,0x20,0x20,0x7C,0x7C,0x00 }, /* '2' */
+    { 0x00,0x7C,0x7C,0x08,0x08,0x10,0x10,0x08,0x08,0x04,0x04,0x44,0x44,0x38,0x38,0x00 }, /* '3' */
+    { 0x00,0x08,0x08,0x18,0x18,0x28,0x28,0x48,0x48,0x7C,0x7C,0x08,0x08,0x08,0x08,0x00 }, /* '4' */
+    { 0x00,0x7C,0x7C,0x40,0x40,0x78,0x78,0x04,0x04,0x04,0x04,0x44,0x44,0x38,0x38,0x00 }, /* '5' */
+    { 0x00,0x18,0x18,0x20,0x20,0x40,0x40,0x78,0x78,0x44,0x44,0x44,0x44,0x38,0x38,0x00 }, /* '6' */
+    { 0x00,0x7C,0x7C,0x04,0x04,0x08,0x08,0x10,0x10,0x20,0x20,0x20,0x20,0x20,0x20,0x00 }, /* '7' */
+    { 0x00,0x38,0x38,0x44,0x44,0x44,0x44,0x38,0x38,0x44,0x44,0x44,0x44,0x38,0x38,0x00 }, /* '8' */
+    { 0x00,0x38,0x38,0x44,0x44,0x44,0x44,0x3C,0x3C,0x04,0x04,0x08,0x08,0x30,0x30,0x00 }, /* '9' */
+    { 0x00,0x00,0x00,0x30,0x30,0x30,0x30,0x00,0x00,0x30,0x30,0x30,0x30,0x00,0x00,0x00 }, /* ':' */
+    { 0x00,0x00,0x00,0x30,0x30,0x30,0x30,0x00,0x00,0x30,0x30,0x10,0x10,0x20,0x20,0x00 }, /* ';' */
+    { 0x00,0x08,0x08,0x10,0x10,0x20,0x20,0x40,0x40,0x20,0x20,0x10,0x10,0x08,0x08,0x00 }, /* '<' */
+    { 0x00,0x00,0x00,0x00,0x00,0x7C,0x7C,0x00,0x00,0x7C,0x7C,0x00,0x00,0x00,0x00,0x00 }, /* '=' */
+    { 0x00,0x20,0x20,0x10,0x10,0x08,0x08,0x04,0x04,0x08,0x08,0x10,0x10,0x20,0x20,0x00 }, /* '>' */
+    { 0x00,0x38,0x38,0x44,0x44,0x04,0x04,0x08,0x08,0x10,0x10,0x00,0x00,0x10,0x10,0x00 }, /* '?' */
+    { 0x00,0x38,0x38,0x44,0x44,0x04,0x04,0x34,0x34,0x54,0x54,0x54,0x54,0x38,0x38,0x00 }, /* '@' */
+    { 0x00,0x38,0x38,0x44,0x44,0x44,0x44,0x7C,0x7C,0x44,0x44,0x44,0x44,0x44,0x44,0x00 }, /* 'A' */
+    { 0x00,0x78,0x78,0x44,0x44,0x44,0x44,0x78,0x78,0x44,0x44,0x44,0x44,0x78,0x78,0x00 }, /* 'B' */
+    { 0x00,0x38,0x38,0x44,0x44,0x40,0x40,0x40,0x40,0x40,0x40,0x44,0x44,0x38,0x38,0x00 }, /* 'C' */
+    { 0x00,0x70,0x70,0x48,0x48,0x44,0x44,0x44,0x44,0x44,0x44,0x48,0x48,0x70,0x70,0x00 }, /* 'D' */
+    { 0x00,0x7C,0x7C,0x40,0x40,0x40,0x40,0x78,0x78,0x40,0x40,0x40,0x40,0x7C,0x7C,0x00 }, /* 'E' */
+    { 0x00,0x7C,0x7C,0x40,0x40,0x40,0x40,0x78,0x78,0x40,0x40,0x40,0x40,0x40,0x40,0x00 }, /* 'F' */
+    { 0x00,0x38,0x38,0x44,0x44,0x40,0x40,0x5C,0x5C,0x44,0x44,0x44,0x44,0x3C,0x3C,0x00 }, /* 'G' */
+    { 0x00,0x44,0x44,0x44,0x44,0x44,0x44,0x7C,0x7C,0x44,0x44,0x44,0x44,0x44,0x44,0x00 }, /* 'H' */
+    { 0x00,0x38,0x38,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x38,0x38,0x00 }, /* 'I' */
+    { 0x00,0x1C,0x1C,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x48,0x48,0x30,0x30,0x00 }, /* 'J' */
+    { 0x00,0x44,0x44,0x48,0x48,0x50,0x50,0x60,0x60,0x50,0x50,0x48,0x48,0x44,0x44,0x00 }, /* 'K' */
+    { 0x00,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x40,0x7C,0x7C,0x00 }, /* 'L' */
+    { 0x00,0x44,0x44,0x6C,0x6C,0x54,0x54,0x54,0x54,0x44,0x44,0x44,0x44,0x44,0x44,0x00 }, /* 'M' */
+    { 0x00,0x44,0x44,0x44,0x44,0x64,0x64,0x54,0x54,0x4C,0x4C,0x44,0x44,0x44,0x44,0x00 }, /* 'N' */
+    { 0x00,0x38,0x38,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x38,0x38,0x00 }, /* 'O' */
+    { 0x00,0x78,0x78,0x44,0x44,0x44,0x44,0x78,0x78,0x40,0x40,0x40,0x40,0x40,0x40,0x00 }, /* 'P' */
+    { 0x00,0x38,0x38,0x44,0x44,0x44,0x44,0x44,0x44,0x54,0x54,0x48,0x48,0x34,0x34,0x00 }, /* 'Q' */
+    { 0x00,0x78,0x78,0x44,0x44,0x44,0x44,0x78,0x78,0x50,0x50,0x48,0x48,0x44,0x44,0x00 }, /* 'R' */
+    { 0x00,0x3C,0x3C,0x40,0x40,0x40,0x40,0x38,0x38,0x04,0x04,0x04,0x04,0x78,0x78,0x00 }, /* 'S' */
+    { 0x00,0x7C,0x7C,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x00 }, /* 'T' */
+    { 0x00,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x38,0x38,0x00 }, /* 'U' */
+    { 0x00,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x44,0x28,0x28,0x10,0x10,0x00 }, /* 'V' */
+    { 0x00,0x44,0x44,0x44,0x44,0x44,0x44,0x54,0x54,0x54,0x54,0x54,0x54,0x28,0x28,0x00 }, /* 'W' */
+    { 0x00,0x44,0x44,0x44,0x44,0x28,0x28,0x10,0x10,0x28,0x28,0x44,0x44,0x44,0x44,0x00 }, /* 'X' */
+    { 0x00,0x44,0x44,0x44,0x44,0x44,0x44,0x28,0x28,0x10,0x10,0x10,0x10,0x10,0x10,0x00 }, /* 'Y' */
+    { 0x00,0x7C,0x7C,0x04,0x04,0x08,0x08,0x10,0x10,0x20,0x20,0x40,0x40,0x7C,0x7C,0x00 }, /* 'Z' */
+    { 0x00,0x38,0x38,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x38,0x38,0x00 }, /* '[' */
+    { 0x00,0x00,0x00,0x40,0x40,0x20,0x20,0x10,0x10,0x08,0x08,0x04,0x04,0x00,0x00,0x00 }, /* '\\' */
+    { 0x00,0x38,0x38,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x38,0x38,0x00 }, /* ']' */
+    { 0x00,0x10,0x10,0x28,0x28,0x44,0x44,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00 }, /* '^' */
+    { 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x7C,0x7C,0x00 }, /* '_' */
+    { 0x00,0x20,0x20,0x10,0x10,0x08,0x08,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00 }, /* '`' */
+    { 0x00,0x00,0x00,0x00,0x00,0x38,0x38,0x04,0x04,0x3C,0x3C,0x44,0x44,0x3C,0x3C,0x00 }, /* 'a' */
+    { 0x00,0x40,0x40,0x40,0x40,0x58,0x58,0x64,0x64,0x44,0x44,0x44,0x44,0x78,0x78,0x00 }, /* 'b' */
+    { 0x00,0x00,0x00,0x00,0x00,0x38,0x38,0x40,0x40,0x40,0x40,0x44,0x44,0x38,0x38,0x00 }, /* 'c' */
+    { 0x00,0x04,0x04,0x04,0x04,0x34,0x34,0x4C,0x4C,0x44,0x44,0x44,0x44,0x3C,0x3C,0x00 }, /* 'd' */
+    { 0x00,0x00,0x00,0x00,0x00,0x38,0x38,0x44,0x44,0x7C,0x7C,0x40,0x40,0x38,0x38,0x00 }, /* 'e' */
+    { 0x00,0x18,0x18,0x24,0x24,0x20,0x20,0x70,0x70,0x20,0x20,0x20,0x20,0x20,0x20,0x00 }, /* 'f' */
+    { 0x00,0x00,0x00,0x3C,0x3C,0x44,0x44,0x44,0x44,0x3C,0x3C,0x04,0x04,0x38,0x38,0x00 }, /* 'g' */
+    { 0x00,0x40,0x40,0x40,0x40,0x58,0x58,0x64,0x64,0x44,0x44,0x44,0x44,0x44,0x44,0x00 }, /* 'h' */
+    { 0x00,0x10,0x10,0x00,0x00,0x30,0x30,0x10,0x10,0x10,0x10,0x10,0x10,0x38,0x38,0x00 }, /* 'i' */
+    { 0x00,0x08,0x08,0x00,0x00,0x18,0x18,0x08,0x08,0x08,0x08,0x48,0x48,0x30,0x30,0x00 }, /* 'j' */
+    { 0x00,0x40,0x40,0x40,0x40,0x48,0x48,0x50,0x50,0x60,0x60,0x50,0x50,0x48,0x48,0x00 }, /* 'k' */
+    { 0x00,0x30,0x30,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x38,0x38,0x00 }, /* 'l' */
+    { 0x00,0x00,0x00,0x00,0x00,0x68,0x68,0x54,0x54,0x54,0x54,0x44,0x44,0x44,0x44,0x00 }, /* 'm' */
+    { 0x00,0x00,0x00,0x00,0x00,0x58,0x58,0x64,0x64,0x44,0x44,0x44,0x44,0x44,0x44,0x00 }, /* 'n' */
+    { 0x00,0x00,0x00,0x00,0x00,0x38,0x38,0x44,0x44,0x44,0x44,0x44,0x44,0x38,0x38,0x00 }, /* 'o' */
+    { 0x00,0x00,0x00,0x00,0x00,0x78,0x78,0x44,0x44,0x78,0x78,0x40,0x40,0x40,0x40,0x00 }, /* 'p' */
+    { 0x00,0x00,0x00,0x00,0x00,0x34,0x34,0x4C,0x4C,0x3C,0x3C,0x04,0x04,0x04,0x04,0x00 }, /* 'q' */
+    { 0x00,0x00,0x00,0x00,0x00,0x58,0x58,0x64,0x64,0x40,0x40,0x40,0x40,0x40,0x40,0x00 }, /* 'r' */
+    { 0x00,0x00,0x00,0x00,0x00,0x38,0x38,0x40,0x40,0x38,0x38,0x04,0x04,0x78,0x78,0x00 }, /* 's' */
+    { 0x00,0x20,0x20,0x20,0x20,0x70,0x70,0x20,0x20,0x20,0x20,0x24,0x24,0x18,0x18,0x00 }, /* 't' */
+    { 0x00,0x00,0x00,0x00,0x00,0x44,0x44,0x44,0x44,0x44,0x44,0x4C,0x4C,0x34,0x34,0x00 }, /* 'u' */
+    { 0x00,0x00,0x00,0x00,0x00,0x44,0x44,0x44,0x44,0x44,0x44,0x28,0x28,0x10,0x10,0x00 }, /* 'v' */
+    { 0x00,0x00,0x00,0x00,0x00,0x44,0x44,0x44,0x44,0x54,0x54,0x54,0x54,0x28,0x28,0x00 }, /* 'w' */
+    { 0x00,0x00,0x00,0x00,0x00,0x44,0x44,0x28,0x28,0x10,0x10,0x28,0x28,0x44,0x44,0x00 }, /* 'x' */
+    { 0x00,0x00,0x00,0x00,0x00,0x44,0x44,0x44,0x44,0x3C,0x3C,0x04,0x04,0x38,0x38,0x00 }, /* 'y' */
+    { 0x00,0x00,0x00,0x00,0x00,0x7C,0x7C,0x08,0x08,0x10,0x10,0x20,0x20,0x7C,0x7C,0x00 }, /* 'z' */
+    { 0x00,0x08,0x08,0x10,0x10,0x10,0x10,0x20,0x20,0x10,0x10,0x10,0x10,0x08,0x08,0x00 }, /* '{' */
+    { 0x00,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x10,0x00 }, /* '|' */
+    { 0x00,0x20,0x20,0x10,0x10,0x10,0x10,0x08,0x08,0x10,0x10,0x10,0x10,0x20,0x20,0x00 }, /* '}' */
+    { 0x00,0x00,0x00,0x00,0x00,0x20,0x20,0x54,0x54,0x08,0x08,0x00,0x00,0x00,0x00,0x00 }, /* '~' */
+};
+
+/* VGA attribute colours as 0x00RRGGBB */
+static const uint32_t vga_palette[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+static int active = 0;
+static int use_sse = 0;
+static int sse_nt = 0;                  /* dst 16-byte aligned: streaming stores */
+
+static volatile uint8_t *fb;
+static uint32_t fb_pitch, fb_w, fb_h;
+static uint32_t cols, rows;
+static uint32_t colors[16];             /* palette in framebuffer pixel format */
+
+/* Text cells and back buffer are both rings of `rows` lines: screen line y
+   lives at ring line (top + y) % rows, so scrolling only moves `top`. */
+static uint16_t *cells;
+static uint32_t *back;                  /* cols*8 x rows*16 pixels */
+static uint32_t back_w;
+static uint32_t top = 0;
+
+/* dirty rectangle in screen pixels, empty when x0 >= x1 */
+static uint32_t dx0, dy0, dx1, dy1;
+static uint32_t nscrolls, nflushes, nfull;
+
+static inline void cpuid(uint32_t leaf,uint32_t* a,uint32_t* b,uint32_t* c,uint32_t* d){
+    __asm__ volatile("cpuid":"=a"(*a),"=b"(*b),"=c"(*c),"=d"(*d):"a"(leaf),"c"(0));
+}
+
+/* CR0.EM=0, CR0.MP=1, CR4.OSFXSR=1, CR4.OSXMMEXCPT=1.
+   Task switches do not save XMM state; that is fine as long as XMM
+   registers are only used inside fbcon_flush, which never yields. */
+static int sse_enable(void){
+    uint32_t a,b,c,d;
+    cpuid(1,&a,&b,&c,&d);
+    if(!(d & (1u<<25))) return 0;
+    uint32_t cr0, cr4;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    cr0 = (cr0 & ~0x4u) | 0x2u;
+    __asm__ volatile("mov %0, %%cr0" :: "r"(cr0));
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= (1u<<9) | (1u<<10);
+    __asm__ volatile("mov %0, %%cr4" :: "r"(cr4));
+    return 1;
+}
+
+static uint32_t pack_rgb(uint32_t rgb, const struct bootinfo_fb *f){
+    uint32_t r = (rgb >> 16) & 0xFF, g = (rgb >> 8) & 0xFF, b = rgb & 0xFF;
+    return ((r >> (8 - f->red_size))   << f->red_pos)
+         | ((g >> (8 - f->green_size)) << f->green_pos)
+         | ((b >> (8 - f->blue_size))  << f->blue_pos);
+}
+
+static void mark_dirty(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1){
+    if(dx0 >= dx1){ dx0 = x0; dy0 = y0; dx1 = x1; dy1 = y1; return; }
+    if(x0 < dx0) dx0 = x0;
+    if(y0 < dy0) dy0 = y0;
+    if(x1 > dx1) dx1 = x1;
+    if(y1 > dy1) dy1 = y1;
+}
+
+int fbcon_init(void){
+    const struct bootinfo *bi = bootinfo_get();
+    if(!bi->has_fb || bi->fb.type != 1 || bi->fb.bpp != 32) return 0;
+    if(bi->fb.addr >> 32) return 0;
+    const struct bootinfo_fb *f = &bi->fb;
+
+    fb_w = f->width; fb_h = f->height; fb_pitch = f->pitch;
+    cols = fb_w / FBCON_FONT_W;
+    rows = fb_h / FBCON_FONT_H;
+    if(cols == 0 || rows == 0) return 0;
+    back_w = cols * FBCON_FONT_W;
+
+    if(paging_map_identity((uint32_t)f->addr, fb_pitch * fb_h, PAGE_RW) != 0) return 0;
+    cells = (uint16_t*)kmalloc(cols * rows * sizeof(uint16_t));
+    back  = (uint32_t*)kmalloc_aligned(back_w * rows * FBCON_FONT_H * 4, 16);
+    if(!cells || !back) return 0;
+
+    fb = (volatile uint8_t*)(uintptr_t)f->addr;
+    for(int i=0;i<16;i++) colors[i] = pack_rgb(vga_palette[i], f);
+
+    use_sse = sse_enable();
+    sse_nt  = use_sse && ((uint32_t)f->addr & 15) == 0 && (fb_pitch & 15) == 0;
+
+    active = 1;
+    top = 0;
+    fbcon_clear(0x0F);
+    return 1;
+}
+
+int fbcon_active(void){ return active; }
+uint32_t fbcon_cols(void){ return cols; }
+uint32_t fbcon_rows(void){ return rows; }
+
+static inline uint32_t ring_line(uint32_t y){
+    uint32_t r = top + y;
+    return r >= rows ? r - rows : r;
+}
+
+static void render_cell(uint32_t x, uint32_t y, uint16_t cell){
+    uint8_t ch = cell & 0xFF, attr = cell >> 8;
+    uint32_t fg = colors[attr & 0xF], bg = colors[(attr >> 4) & 0xF];
+    const uint8_t *glyph = (ch >= 32 && ch < 127) ? font8x16[ch - 32] : font8x16[0];
+    uint32_t *p = back + ring_line(y) * FBCON_FONT_H * back_w + x * FBCON_FONT_W;
+    for(int gy=0; gy<FBCON_FONT_H; gy++){
+        uint8_t bits = glyph[gy];
+        for(int gx=0; gx<FBCON_FONT_W; gx++)
+            p[gx] = (bits & (0x80 >> gx)) ? fg : bg;
+        p += back_w;
+    }
+}
+
+void fbcon_put_cell(uint32_t x, uint32_t y, uint16_t cell){
+    if(!active || x >= cols || y >= rows) return;
+    uint16_t *c = &cells[ring_line(y) * cols + x];
+    if(*c == cell) return;
+    *c = cell;
+    render_cell(x, y, cell);
+    mark_dirty(x * FBCON_FONT_W, y * FBCON_FONT_H, (x+1) * FBCON_FONT_W, (y+1) * FBCON_FONT_H);
+}
+
+uint16_t fbcon_get_cell(uint32_t x, uint32_t y){
+    if(!active || x >= cols || y >= rows) return 0;
+    return cells[ring_line(y) * cols + x];
+}
+
+static void clear_line(uint32_t y, uint8_t attr){
+    uint16_t blank = (uint16_t)' ' | ((uint16_t)attr << 8);
+    uint16_t *c = &cells[ring_line(y) * cols];
+    for(uint32_t x=0;x<cols;x++) c[x] = blank;
+    uint32_t bg = colors[(attr >> 4) & 0xF];
+    uint32_t *p = back + ring_line(y) * FBCON_FONT_H * back_w;
+    for(uint32_t i=0;i<back_w * FBCON_FONT_H;i++) p[i] = bg;
+}
+
+void fbcon_scroll(uint8_t attr){
+    if(!active) return;
+    top = ring_line(1);
+    clear_line(rows - 1, attr);
+    nscrolls++;
+    /* every visible line moved: the whole screen needs a blit */
+    mark_dirty(0, 0, back_w, rows * FBCON_FONT_H);
+}
+
+void fbcon_clear(uint8_t attr){
+    if(!active) return;
+    for(uint32_t y=0;y<rows;y++) clear_line(y, attr);
+    mark_dirty(0, 0, back_w, rows * FBCON_FONT_H);
+}
+
+/* one scanline with SSE; n is a multiple of 16. Compiled for the SSE
+   target only so the asm may name xmm0; only called when use_sse. */
+__attribute__((target("sse")))
+static void copy_line_sse(volatile uint8_t *dst, const uint32_t *src, uint32_t n){
+    const uint8_t *s = (const uint8_t*)src;
+    if(sse_nt){
+        for(uint32_t i=0;i<n;i+=16)
+            __asm__ volatile("movups (%0), %%xmm0\n movntps %%xmm0, (%1)"
+                             :: "r"(s + i), "r"(dst + i) : "memory", "xmm0");
+    } else {
+        for(uint32_t i=0;i<n;i+=16)
+            __asm__ volatile("movups (%0), %%xmm0\n movups %%xmm0, (%1)"
+                             :: "r"(s + i), "r"(dst + i) : "memory", "xmm0");
+    }
+}
+
+static void copy_line(volatile uint8_t *dst, const uint32_t *src, uint32_t n){
+    if(use_sse && (n & 15) == 0){
+        copy_line_sse(dst, src, n);
+        return;
+    }
+    uint32_t words = n / 4;
+    __asm__ volatile("rep movsl" : "+D"(dst), "+S"(src), "+c"(words) :: "memory");
+}
+
+void fbcon_flush(void){
+    if(!active || dx0 >= dx1) return;
+    uint32_t bytes = (dx1 - dx0) * 4;
+    nflushes++;
+    if(dx0 == 0 && dy0 == 0 && dx1 == back_w && dy1 == rows * FBCON_FONT_H) nfull++;
+    for(uint32_t y=dy0; y<dy1; y++){
+        uint32_t line = y / FBCON_FONT_H, sub = y % FBCON_FONT_H;
+        const uint32_t *src = back + (ring_line(line) * FBCON_FONT_H + sub) * back_w + dx0;
+        copy_line(fb + y * fb_pitch + dx0 * 4, src, bytes);
+    }
+    if(sse_nt) __asm__ volatile("sfence" ::: "memory");
+    dx0 = dx1 = 0;
+}
+
+void fbcon_get_stats(struct fbcon_stats *s){
+    s->scrolls = nscrolls;
+    s->flushes = nflushes;
+    s->full_flushes = nfull;
+    s->screen_bytes = fb_pitch * fb_h;
+}
+
+void fbcon_info(void){
+    if(!active){
+        vga_writeln("fbcon: inactive (VGA text mode)");
+        return;
+    }
+    char b[16];
+    vga_write("fbcon: ");
+    shell_utoa32(fb_w, b); vga_write(b); vga_write("x");
+    shell_utoa32(fb_h, b); vga_write(b); vga_write(" ");
+    shell_utoa32(cols, b); vga_write(b); vga_write("x");
+    shell_utoa32(rows, b); vga_write(b); vga_write(" cells, blit=");
+    vga_writeln(sse_nt ? "sse-nt" : use_sse ? "sse" : "movsl");
+}
@@ -0,0 +1,37 @@
+#ifndef FBCON_H
+#define FBCON_H
+#include <stdint.h>
+
+/* Graphics text console on the Multiboot2 linear framebuffer.
+   Cells are rendered with a built-in 8x16 font into a RAM back buffer;
+   fbcon_flush copies only the dirty rectangle to the framebuffer.
+   The Multiboot framebuffer cannot be panned, so a flush after a scroll
+   still copies the whole screen; vga_hold/vga_release batch a burst of
+   lines into one such copy. */
+
+#define FBCON_FONT_W 8
+#define FBCON_FONT_H 16
+
+int  fbcon_init(void);              /* 1 if a usable 32 bpp framebuffer was found */
+int  fbcon_active(void);
+uint32_t fbcon_cols(void);
+uint32_t fbcon_rows(void);
+
+/* cell = character | attr << 8, same encoding as the VGA text buffer */
+void fbcon_put_cell(uint32_t x, uint32_t y, uint16_t cell);
+uint16_t fbcon_get_cell(uint32_t x, uint32_t y);
+void fbcon_scroll(uint8_t attr);    /* one line up; O(1) on the back buffer */
+void fbcon_clear(uint8_t attr);
+void fbcon_flush(void);
+
+struct fbcon_stats {
+    uint32_t scrolls;
+    uint32_t flushes;
+    uint32_t full_flushes;              /* flushes that copied the whole screen */
+    uint32_t screen_bytes;              /* size of one full copy */
+};
+void fbcon_get_stats(struct fbcon_stats *s);
+
+void fbcon_info(void);
+
+#endif
@@ -0,0 +1,66 @@
+#include "gdt.h"
+#include <stdint.h>
+
+struct gdt_entry {
+    uint16_t limit_lo;
+    uint16_t base_lo;
+    uint8_t  base_mid;
+    uint8_t  access;
+    uint8_t  gran;
+    uint8_t  base_hi;
+} __attribute__((packed));
+
+struct gdt_ptr { uint16_t limit; uint32_t base; } __attribute__((packed));
+
+struct tss {
+    uint32_t prev, esp0, ss0, esp1, ss1, esp2, ss2;
+    uint32_t cr3, eip, eflags, eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    uint32_t es, cs, ss, ds, fs, gs, ldt;
+    uint16_t trap, iomap_base;
+} __attribute__((packed));
+
+static struct gdt_entry gdt[6];
+static struct gdt_ptr gdtp;
+static struct tss tss;
+
+static void gdt_set(int n, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran){
+    gdt[n].limit_lo = limit & 0xFFFF;
+    gdt[n].base_lo  = base & 0xFFFF;
+    gdt[n].base_mid = (base >> 16) & 0xFF;
+    gdt[n].access   = access;
+    gdt[n].gran     = (uint8_t)(((limit >> 16) & 0x0F) | (gran & 0xF0));
+    gdt[n].base_hi  = (base >> 24) & 0xFF;
+}
+
+void gdt_init(void){
+    gdt_set(0, 0, 0, 0, 0);
+    gdt_set(1, 0, 0xFFFFF, 0x9A, 0xC0);     /* kernel code */
+    gdt_set(2, 0, 0xFFFFF, 0x92, 0xC0);     /* kernel data */
+    gdt_set(3, 0, 0xFFFFF, 0xFA, 0xC0);     /* user code, DPL3 */
+    gdt_set(4, 0, 0xFFFFF, 0xF2, 0xC0);     /* user data, DPL3 */
+
+    for(uint32_t i=0;i<sizeof(tss);i++) ((uint8_t*)&tss)[i] = 0;
+    tss.ss0 = KERNEL_DS;
+    tss.iomap_base = sizeof(tss);           /* no I/O bitmap */
+    gdt_set(5, (uint32_t)&tss, sizeof(tss)-1, 0x89, 0x00);
+
+    gdtp.limit = sizeof(gdt)-1;
+    gdtp.base  = (uint32_t)gdt;
+    __asm__ volatile(
+        "lgdt (%0)\n"
+        "ljmp $0x08, $1f\n"
+        "1:\n"
+        "mov $0x10, %%ax\n"
+        "mov %%ax, %%ds\n"
+        "mov %%ax, %%es\n"
+        "mov %%ax, %%fs\n"
+        "mov %%ax, %%gs\n"
+        "mov %%ax, %%ss\n"
+        "mov $0x28, %%ax\n"
+        "ltr %%ax\n"
+        :: "r"(&gdtp) : "eax", "memory");
+}
+
+void gdt_set_kernel_stack(uint32_t esp0){
+    tss.esp0 = esp0;
+}
@@ -0,0 +1,18 @@
+#ifndef GDT_H
+#define GDT_H
+#include <stdint.h>
+
+/* Selector layout is fixed by SYSENTER/SYSEXIT: kernel CS, kernel SS =
+   CS+8, user CS = CS+16, user SS = CS+24. */
+#define KERNEL_CS  0x08
+#define KERNEL_DS  0x10
+#define USER_CS    0x1B     /* 0x18 | RPL 3 */
+#define USER_DS    0x23     /* 0x20 | RPL 3 */
+#define TSS_SEL    0x28
+
+void gdt_init(void);
+
+/* kernel stack used on ring 3 -> ring 0 transitions (TSS.esp0) */
+void gdt_set_kernel_stack(uint32_t esp0);
+
+#endif
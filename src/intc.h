@@ -0,0 +1,34 @@
+#ifndef INTC_H
+#define INTC_H
+#include <stdint.h>
+
+/* Interrupt controller backend. irq.c owns the IDT and routes
+   unmask/EOI/timer calls to the active backend: the legacy 8259 + PIT
+   (always available) or the local APIC + I/O APIC. ISA IRQ n arrives on
+   vector 32+n with either; the periodic tick always uses vector 32. */
+struct intc {
+    const char *name;
+    int       (*init)(void);                /* 0 on success */
+    void      (*unmask)(int irq);
+    void      (*eoi)(int irq);
+    void      (*timer_start)(uint32_t hz);     /* (re)start the periodic tick */
+    void      (*timer_oneshot)(uint64_t tsc);  /* stop it; fire once at TSC value */
+    void      (*timer_ack)(void);           /* re-arm on each tick, or 0 */
+    uint32_t  (*timer_delay_ns)(void);      /* time since the timer fired */
+    const char* (*timer_mode)(void);
+};
+
+extern const struct intc intc_pic;
+extern const struct intc intc_apic;
+
+/* 8259/PIT helpers shared with the APIC backend and TSC calibration */
+void pic_disable(void);                     /* mask every 8259 line */
+void pit_delay_ms(uint32_t ms);             /* busy-wait on PIT channel 2, ms <= 50 */
+void pit_ch2_start(uint32_t ms);            /* pit_delay_ms in two halves, so callers */
+void pit_ch2_wait(void);                    /* can stamp the start closely */
+
+/* APIC backend details for `intcstat` (0 when not in use) */
+uint32_t apic_timer_freq(void);             /* LAPIC timer input clock / 16, Hz */
+uint32_t apic_ioapic_pins(void);
+
+#endif
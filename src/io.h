@@ -0,0 +1,41 @@
+#ifndef IO_H
+#define IO_H
+#include <stdint.h>
+
+/* Port I/O. In the hosted test build (-DHOSTED, `make test`) these go to
+   the fake devices in tests/host_shim.c instead of real ports. */
+
+#ifdef HOSTED
+uint8_t host_inb(uint16_t p);
+void    host_outb(uint16_t p, uint8_t v);
+static inline uint8_t inb(uint16_t p){ return host_inb(p); }
+static inline void outb(uint16_t p, uint8_t v){ host_outb(p, v); }
+#else
+static inline uint8_t inb(uint16_t p){
+    uint8_t r;
+    __asm__ volatile("inb %1,%0":"=a"(r):"Nd"(p));
+    return r;
+}
+static inline void outb(uint16_t p, uint8_t v){
+    __asm__ volatile("outb %0,%1"::"a"(v),"Nd"(p));
+}
+#endif
+
+/* Disable interrupts and return the previous EFLAGS for irq_restore, so
+   sections nest and are safe from IRQ context. No-ops when HOSTED. */
+#ifdef HOSTED
+static inline uint32_t irq_save(void){ return 0; }
+static inline void irq_restore(uint32_t f){ (void)f; }
+#else
+static inline uint32_t irq_save(void){
+    uint32_t f;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(f) :: "memory");
+    return f;
+}
+
+static inline void irq_restore(uint32_t f){
+    __asm__ volatile("pushl %0; popfl" :: "r"(f) : "memory", "cc");
+}
+#endif
+
+#endif
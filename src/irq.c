@@ -1,8 +1,21 @@
 #include <stdint.h>
+#include "irq.h"
+#include "io.h"
+#include "prof.h"
+#include "task.h"
+#include "workq.h"
+#include "latency.h"
+#include "intc.h"
+#include "acpi.h"
+#include "bootinfo.h"
+#include "tsc.h"
+#include "math64.h"
+#include "shell.h"
 
-extern void task_on_tick(void);
+extern void kbd_isr(void);
+extern void vga_writeln(const char* s);
+extern void vga_write(const char* s);
 
-static inline void outb(uint16_t p, uint8_t v){ __asm__ volatile("outb %0,%1"::"a"(v),"Nd"(p)); }
 static inline uint16_t get_cs(){ uint16_t s; __asm__ volatile("mov %%cs,%0":"=r"(s)); return s; }
 
 struct idt_entry{ uint16_t off_lo; uint16_t sel; uint8_t zero; uint8_t flags; uint16_t off_hi; } __attribute__((packed));
@@ -13,18 +26,151 @@ static struct idt_ptr idtp;
 
 static volatile uint32_t ticks=0;
 
-void timer_isr(){ 
-  ticks++;
-  task_on_tick();
+static const struct intc *intc = &intc_pic;
+static uint32_t hz = 100;
+
+/* intcstat: ISR-entry TSC of consecutive ticks */
+#define JITTER_TICKS 200
+static uint64_t jitter_tsc[JITTER_TICKS + 1];
+static volatile uint32_t jitter_n = JITTER_TICKS + 1;     /* idle when full */
+
+static void jitter_tick(void){
+    jitter_tsc[jitter_n++] = rdtsc();
+}
+
+/* ---- dynamic tick (nohz) ----
+   With nohz on, the timer runs in one-shot mode: every tick while two
+   or more tasks compete for the CPU, else straight to the earliest sleep
+   expiry. `ticks` is then derived from the TSC, so it stays exact however
+   many tick periods pass between interrupts. */
+#define NOHZ_MAX_TICKS  hz          /* at most 1 s without an interrupt */
+
+static int nohz_on = 0;
+static int tick_stopped = 0;
+static uint64_t tick_period_tsc;
+static uint64_t tick_tsc_last;      /* TSC at the last accounted tick boundary */
+static uint32_t ticks_pending;      /* caught up but not yet given to task_on_tick */
+static volatile uint32_t timer_irqs = 0;
+volatile uint32_t irq_total = 0;    /* all hardware interrupts (irq1_stub counts too) */
+
+/* call with interrupts off */
+static void ticks_catch_up(void){
+    uint64_t d = rdtsc() - tick_tsc_last;
+    if(d < tick_period_tsc) return;
+    uint32_t n = (uint32_t)div64_32(d, (uint32_t)tick_period_tsc, 0);
+    tick_tsc_last += (uint64_t)n * tick_period_tsc;
+    ticks += n;
+    ticks_pending += n;
+}
+
+/* call with interrupts off */
+static void nohz_program(void){
+    uint32_t until_wake;
+    int nr = task_nohz_state(ticks, &until_wake);
+    uint32_t k = 1;
+    if(nr <= 1){
+        k = until_wake;
+        if(k > NOHZ_MAX_TICKS) k = NOHZ_MAX_TICKS;
+        if(k == 0) k = 1;
+    }
+    tick_stopped = k > 1;
+    intc->timer_oneshot(tick_tsc_last + (uint64_t)k * tick_period_tsc);
+}
+
+void timer_nohz_kick(void){
+    if(!nohz_on || !tick_stopped) return;
+    uint32_t f = irq_save();
+    ticks_catch_up();
+    nohz_program();
+    irq_restore(f);
+}
+
+void timer_nohz_idle(void){
+    if(!nohz_on) return;
+    uint32_t f = irq_save();
+    ticks_catch_up();
+    nohz_program();
+    irq_restore(f);
+}
+
+int timer_nohz_set(int on){
+    uint32_t f = irq_save();
+    if(on && !nohz_on){
+        tick_period_tsc = div64_32((uint64_t)tsc_khz() * 1000u, hz, 0);
+        if(tick_period_tsc > 0xFFFFFFFFu || tick_period_tsc == 0){ irq_restore(f); return -1; }
+        tick_tsc_last = rdtsc();
+        nohz_on = 1;
+        nohz_program();
+    } else if(!on && nohz_on){
+        ticks_catch_up();
+        nohz_on = 0;
+        tick_stopped = 0;
+        intc->timer_start(hz);
+    }
+    irq_restore(f);
+    return 0;
+}
+
+int timer_nohz_enabled(void){ return nohz_on; }
+int timer_tick_stopped(void){ return tick_stopped; }
+uint32_t timer_irq_count(void){ return timer_irqs; }
+uint32_t irq_count(void){ return irq_total; }
+
+static void timer_bottom(uint32_t n){
+  task_on_tick(n);
+}
+
+/* top half: count the tick, sample, defer the scheduler bookkeeping */
+void timer_isr(struct irq_frame *f){
+  uint32_t n;
+  timer_irqs++;
+  irq_total++;
+  if(nohz_on){
+    ticks_catch_up();
+    n = ticks_pending;
+    ticks_pending = 0;
+  } else {
+    ticks++;
+    n = 1;
+  }
+  if(n){
+    if(latency_active) latency_on_timer(ticks);
+    if(jitter_n <= JITTER_TICKS) jitter_tick();
+  }
+  if(!nohz_on && intc->timer_ack) intc->timer_ack();
+  prof_sample(f->eip, f->ebp);
+  if(n) workq_queue(WQ_TIMER, timer_bottom, n);
+  irq_eoi(0);
+  workq_run_irq_exit();
+  if(nohz_on){
+    /* softirqs may have woken tasks; interrupts are off again here */
+    ticks_catch_up();
+    nohz_program();
+  }
+
+  /* ring-3 code never calls scheduler_maybe_yield itself, so honour the
+     reschedule hint here; EOI is already sent and the switched-to task
+     restores its own EFLAGS */
+  if((f->cs & 3) == 3) scheduler_maybe_yield();
 }
 
 __attribute__((naked)) void irq0_stub(){
     __asm__ volatile(
         "pusha\n"
+        "push %esp\n"
         "call timer_isr\n"
+        "add $4, %esp\n"
+        "popa\n"
+        "iret\n"
+    );
+}
+
+__attribute__((naked)) void irq1_stub(){
+    __asm__ volatile(
+        "pusha\n"
+        "incl irq_total\n"
+        "call kbd_isr\n"
         "popa\n"
-        "movb $0x20, %al\n"
-        "outb %al, $0x20\n"
         "iret\n"
     );
 }
@@ -43,34 +189,113 @@ static void idt_load(){
     __asm__ volatile("lidt (%0)"::"r"(&idtp));
 }
 
-static void pic_remap_and_mask(){
-    outb(0x20,0x11);
-    outb(0xA0,0x11);
-    outb(0x21,0x20);
-    outb(0xA1,0x28);
-    outb(0x21,0x04);
-    outb(0xA1,0x02);
-    outb(0x21,0x01);
-    outb(0xA1,0x01);
-    outb(0x21,0xFE);
-    outb(0xA1,0xFF);
-}
+void irq_unmask(int irq){ intc->unmask(irq); }
+void irq_eoi(int irq){ intc->eoi(irq); }
+uint32_t timer_irq_delay_ns(void){ return intc->timer_delay_ns(); }
+uint32_t timer_hz(void){ return hz; }
 
-static void pit_init(uint32_t hz){
-    uint16_t div = (uint16_t)(1193182u / hz);
-    outb(0x43,0x36);
-    outb(0x40,div & 0xFF);
-    outb(0x40,div >> 8);
+void irq_set_gate(int n, void (*handler)(void), uint8_t flags){
+    idt_set_gate(n, (uint32_t)handler, get_cs(), flags);
 }
 
+/* IDT plus the legacy 8259/PIT backend, usable before paging and the heap */
 void irq_init(){
     for(int i=0;i<256;i++) idt[i]=(struct idt_entry){0,0,0,0,0};
     uint16_t cs = get_cs();
-    idt_set_gate(32, (uint32_t)irq0_stub, cs, 0x8E);
-    pic_remap_and_mask();
+    idt_set_gate(32, (uint32_t)irq0_stub, cs, IDT_GATE_INT);
+    idt_set_gate(33, (uint32_t)irq1_stub, cs, IDT_GATE_INT);
     idt_load();
-    pit_init(100);
+
+    /* PIT divisor is 16 bits: 19 Hz minimum */
+    hz = bootinfo_opt_uint("hz", 100);
+    if(hz < 20) hz = 20;
+    if(hz > 10000) hz = 10000;
+
+    intc = &intc_pic;
+    intc->init();
+    intc->unmask(1);
+    intc->timer_start(hz);
+}
+
+/* Switch to the LAPIC/I/O APIC backend unless `intc=pic` is given or the
+   CPU/ACPI tables do not offer one. Needs paging and the heap (the APIC
+   registers are mapped on demand). */
+void irq_select_intc(void){
+    const char *want = bootinfo_opt("intc");
+    if(want && shell_streq(want, "pic")) return;
+
+    uint32_t flags = irq_save();
+    if(intc_apic.init() == 0){
+        intc = &intc_apic;
+        intc->unmask(1);
+        intc->timer_start(hz);
+    }
+    irq_restore(flags);
 }
 
-uint32_t timer_ticks(){ return ticks; }
+/* ---- intcstat: EOI cost and tick jitter ---- */
 
+static void print_kv(const char *k, uint32_t v, const char *unit){
+    char t[16];
+    shell_utoa32(v, t);
+    vga_write(k); vga_write(t); vga_writeln(unit);
+}
+
+/* average cycles of one EOI write with interrupts off; an EOI with no
+   interrupt in service is ignored by both controllers */
+static uint32_t eoi_cycles(const struct intc *c){
+    uint32_t flags = irq_save();
+    uint64_t t0 = rdtsc();
+    for(int i=0;i<1000;i++) c->eoi(0);
+    uint64_t t1 = rdtsc();
+    irq_restore(flags);
+    return (uint32_t)div64_32(t1 - t0, 1000, 0);
+}
+
+void irq_intc_stats_print(void){
+    const struct acpi_madt *m = acpi_madt();
+    vga_write("controller: "); vga_writeln(intc->name);
+    vga_write("timer:      "); vga_writeln(intc->timer_mode());
+    print_kv("tick rate:  ", hz, " Hz");
+    if(intc == &intc_apic){
+        print_kv("lapic timer: ", apic_timer_freq(), " Hz (/16)");
+        print_kv("ioapic pins: ", apic_ioapic_pins(), "");
+    }
+    if(m->found) print_kv("cpus (MADT): ", m->ncpus, "");
+
+    print_kv("eoi 8259:   ", eoi_cycles(&intc_pic), " cycles");
+    if(intc == &intc_apic) print_kv("eoi lapic:  ", eoi_cycles(&intc_apic), " cycles");
+
+    if(nohz_on){
+        vga_writeln("jitter: n/a while nohz is on (needs the periodic tick)");
+        return;
+    }
+
+    /* tick-to-tick interval vs the nominal period */
+    jitter_n = 0;
+    while(jitter_n <= JITTER_TICKS) task_sleep(hz / 10 + 1);
+
+    struct lat_hist h;
+    lat_hist_reset(&h);
+    uint64_t nominal = div64_32((uint64_t)1000000000u, hz, 0);
+    for(int i=1;i<=JITTER_TICKS;i++){
+        uint64_t ns = tsc_to_ns(jitter_tsc[i] - jitter_tsc[i-1]);
+        uint64_t dev = ns > nominal ? ns - nominal : nominal - ns;
+        lat_hist_add(&h, dev > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)dev);
+    }
+    print_kv("jitter over ", JITTER_TICKS, " ticks (|interval - period|):");
+    print_kv("  min ", h.min_ns, " ns");
+    print_kv("  avg ", lat_hist_avg(&h), " ns");
+    print_kv("  p99 ", lat_hist_percentile(&h, 99), " ns");
+    print_kv("  max ", h.max_ns, " ns");
+}
+
+/* under nohz the tick may be stopped: bring `ticks` up to date first */
+uint32_t timer_ticks(){
+    if(nohz_on){
+        uint32_t f = irq_save();
+        ticks_catch_up();
+        irq_restore(f);
+    }
+    return ticks;
+}
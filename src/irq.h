@@ -0,0 +1,44 @@
+#ifndef IRQ_H
+#define IRQ_H
+#include <stdint.h>
+
+/* stack layout seen by C interrupt handlers: pusha block, then the CPU's
+   iret frame (user_esp/user_ss only present when coming from ring 3) */
+struct irq_frame {
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;
+    uint32_t eip, cs, eflags;
+    uint32_t user_esp, user_ss;
+};
+
+#define IDT_GATE_INT    0x8E    /* present, DPL0, 32-bit interrupt gate */
+#define IDT_GATE_USER   0xEF    /* present, DPL3, 32-bit trap gate */
+
+/* IDT, 8259 PIC and PIT tick at `hz=` from the cmdline (default 100) */
+void irq_init(void);
+/* after paging: move to the LAPIC/I/O APIC unless `intc=pic` */
+void irq_select_intc(void);
+void irq_intc_stats_print(void);
+void irq_set_gate(int n, void (*handler)(void), uint8_t flags);
+void irq_unmask(int irq);
+void irq_eoi(int irq);
+uint32_t timer_ticks(void);
+uint32_t timer_hz(void);
+
+/* dynamic tick: one-shot timer to the next real deadline, tick stopped
+   while at most one task is runnable; `ticks` catches up from the TSC */
+int  timer_nohz_set(int on);        /* -1 if the TSC is unusable */
+int  timer_nohz_enabled(void);
+int  timer_tick_stopped(void);
+void timer_nohz_kick(void);         /* a task became runnable */
+void timer_nohz_idle(void);         /* about to hlt with nothing runnable */
+
+/* interrupt counters since boot */
+uint32_t timer_irq_count(void);
+uint32_t irq_count(void);
+
+/* time since the tick timer last expired (PIT or LAPIC count, or the
+   TSC deadline); called early in the timer ISR this is the interrupt
+   delivery delay */
+uint32_t timer_irq_delay_ns(void);
+
+#endif
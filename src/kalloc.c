@@ -1,10 +1,78 @@
 #include "kalloc.h"
 #include <stdint.h>
 #include <stddef.h>
+#ifdef KALLOC_TRACE
+#include "task.h"
+#endif
 
 static uint32_t heap_start = 0;
 static uint32_t heap_ptr = 0;
 
+#ifdef KALLOC_TRACE
+/* per-callsite statistics, open addressing keyed by return address */
+static struct kmprof_site sites[KMPROF_SITES];
+static uint32_t lost;                              /* allocations from sites that did not fit */
+static struct kmprof_rec recent[KMPROF_RECENT];    /* ring of the last allocations */
+static uint32_t recent_n;
+
+/* bucket 0 is <= 16 bytes, then each bucket is 4x the previous one */
+static uint32_t size_bucket(size_t n){
+    if(n <= 16) return 0;
+    int bits = 32 - __builtin_clz((uint32_t)n - 1);
+    uint32_t b = (uint32_t)(bits - 3) / 2;
+    return b < KMPROF_BUCKETS ? b : KMPROF_BUCKETS - 1;
+}
+
+static struct kmprof_site* site_slot(uint32_t site){
+    uint32_t h = (site * 2654435761u) >> (32 - KMPROF_SITES_SHIFT);
+    for(uint32_t i=0;i<KMPROF_SITES;i++){
+        struct kmprof_site *s = &sites[(h + i) & (KMPROF_SITES - 1)];
+        if(s->site == site) return s;
+        if(s->site == 0){ s->site = site; s->task = KMPROF_NO_TASK; return s; }
+    }
+    return 0;
+}
+
+static void trace_alloc(uint32_t site, size_t n, uint32_t addr){
+    int task = task_current_id();
+    struct kmprof_rec *r = &recent[recent_n++ % KMPROF_RECENT];
+    r->site = site; r->addr = addr; r->size = (uint32_t)n; r->task = task;
+
+    struct kmprof_site *s = site_slot(site);
+    if(!s){ lost++; return; }
+    if(s->task == KMPROF_NO_TASK) s->task = task;
+    else if(s->task != task) s->task = KMPROF_MANY_TASKS;
+    s->count++;
+    s->bytes += (uint32_t)n;
+    s->hist[size_bucket(n)]++;
+}
+
+const struct kmprof_site* kmprof_sites(uint32_t *lost_out){
+    if(lost_out) *lost_out = lost;
+    return sites;
+}
+
+int kmprof_recent(struct kmprof_rec *out, int max){
+    uint32_t n = recent_n < KMPROF_RECENT ? recent_n : KMPROF_RECENT;
+    int k = 0;
+    for(uint32_t i=0;i<n && k<max;i++) out[k++] = recent[(recent_n - 1 - i) % KMPROF_RECENT];
+    return k;
+}
+
+void kmprof_reset(void){
+    for(uint32_t i=0;i<KMPROF_SITES;i++) sites[i] = (struct kmprof_site){0};
+    lost = 0;
+    recent_n = 0;
+}
+
+/* the return address only names the caller if the allocator keeps its own frame */
+#define TRACED __attribute__((noinline))
+#define TRACE(n, p) trace_alloc((uint32_t)(uintptr_t)__builtin_return_address(0), (n), (p))
+#else
+#define TRACED
+#define TRACE(n, p) ((void)0)
+#endif
+
 void kalloc_init(uint32_t start_phys){
     if(start_phys == 0) return;
     heap_start = start_phys;
@@ -12,13 +80,23 @@ void kalloc_init(uint32_t start_phys){
 }
 
 /* minimal 8-byte align bump allocator */
-void* kmalloc(size_t n){
+TRACED void* kmalloc(size_t n){
     if(heap_ptr == 0) return (void*)0;
     /* align to 8 */
     uint32_t cur = (heap_ptr + 7) & ~((uint32_t)7);
     uint32_t next = cur + (uint32_t)n;
     /* naive overflow/limit check is omitted — you can add checks if you like */
     heap_ptr = next;
+    TRACE(n, cur);
+    return (void*)(uintptr_t)cur;
+}
+
+TRACED void* kmalloc_aligned(size_t n, uint32_t align){
+    if(heap_ptr == 0) return (void*)0;
+    if(align < 8) align = 8;
+    uint32_t cur = (heap_ptr + align - 1) & ~(align - 1);
+    heap_ptr = cur + (uint32_t)n;
+    TRACE(n, cur);
     return (void*)(uintptr_t)cur;
 }
 
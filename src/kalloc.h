@@ -5,9 +5,40 @@
 
 void kalloc_init(uint32_t start_phys);
 void* kmalloc(size_t n);
+void* kmalloc_aligned(size_t n, uint32_t align);   /* align: power of two */
 uint32_t kalloc_get_ptr(void);
 uint32_t kalloc_get_start(void);
 uint32_t kalloc_bytes_used(void);
 
+/* Allocation profiling, built with `make KALLOC_TRACE=1`.
+   Every kmalloc/kmalloc_aligned records its caller and the current task;
+   without the flag none of this is compiled and the allocator is unchanged. */
+#ifdef KALLOC_TRACE
+#define KMPROF_SITES_SHIFT 6
+#define KMPROF_SITES       (1u << KMPROF_SITES_SHIFT)
+#define KMPROF_BUCKETS     8        /* <=16, <=64, <=256, ... <=64K, larger */
+#define KMPROF_RECENT      16
+#define KMPROF_NO_TASK     (-2)     /* slot claimed, no allocation yet */
+#define KMPROF_MANY_TASKS  (-3)     /* site used by more than one task */
+
+struct kmprof_site {
+    uint32_t site;                  /* caller return address, 0 = free slot */
+    uint32_t count;
+    uint32_t bytes;
+    int      task;                  /* task id (-1 before tasking) or KMPROF_MANY_TASKS */
+    uint32_t hist[KMPROF_BUCKETS];
+};
+
+struct kmprof_rec {
+    uint32_t site, addr, size;
+    int      task;
+};
+
+/* the KMPROF_SITES-entry table; *lost = allocations from sites that did not fit */
+const struct kmprof_site* kmprof_sites(uint32_t *lost);
+/* the last allocations, newest first; returns the number written */
+int kmprof_recent(struct kmprof_rec *out, int max);
+void kmprof_reset(void);
 #endif
 
+#endif
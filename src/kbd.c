@@ -1,27 +1,21 @@
 #include <stdint.h>
+#include "io.h"
+#include "irq.h"
+#include "workq.h"
+#include "task.h"
 
-uint8_t inb(uint16_t p){
-    uint8_t r;
-    __asm__ volatile("inb %1,%0" : "=a"(r) : "Nd"(p));
-    return r;
-}
-
-extern void scheduler_maybe_yield(void);
+extern void coro_key_event(char c);
 
-static int ready(){
-    return inb(0x64) & 1;
-}
+/* decoded characters, filled by the bottom half, drained by kbd_getch */
+#define KBD_FIFO 64     /* power of two */
+static volatile char fifo[KBD_FIFO];
+static volatile uint32_t fifo_head = 0, fifo_tail = 0;
+static volatile int reader = -1;    /* task blocked in kbd_getch */
 
-char kbd_getch(){
+/* scancode set 1 -> ASCII; returns 0 for releases, modifiers and unmapped keys */
+static char kbd_decode(uint8_t s){
     static int shift = 0;
 
-    /* BLOCKING wait: we know this worked reliably before */
-    while(!ready()) {
-      scheduler_maybe_yield();
-    }
-
-    uint8_t s = inb(0x60);
-
     if(s == 0xE0) return 0;  /* ignore extended for now */
 
     if(s & 0x80){
@@ -58,3 +52,47 @@ char kbd_getch(){
     return 0;
 }
 
+/* bottom half: decode one scancode into the character FIFO */
+static void kbd_bottom(uint32_t scancode){
+    char c = kbd_decode((uint8_t)scancode);
+    if(c == 0) return;
+    coro_key_event(c);                              /* wakes CORO_AWAIT_KEY */
+    if(fifo_head - fifo_tail >= KBD_FIFO) return;   /* full: drop */
+    fifo[fifo_head & (KBD_FIFO-1)] = c;
+    fifo_head++;
+    if(reader >= 0) task_wake(reader);
+}
+
+/* IRQ1 top half: read the scancode and defer the decoding */
+void kbd_isr(void){
+    uint8_t s = inb(0x60);
+    workq_queue(WQ_KBD, kbd_bottom, s);
+    irq_eoi(1);
+    workq_run_irq_exit();
+}
+
+/* non-blocking: next character, or 0 if none is queued */
+char kbd_trygetch(void){
+    if(fifo_tail == fifo_head) return 0;
+    char c = fifo[fifo_tail & (KBD_FIFO-1)];
+    fifo_tail++;
+    return c;
+}
+
+char kbd_getch(){
+    /* block until the bottom half delivers a character, so a waiting
+       shell is not runnable (idle hlt, dynamic tick) */
+    while(fifo_tail == fifo_head){
+        uint32_t f = irq_save();
+        if(fifo_tail == fifo_head){
+            reader = task_current_id();
+            task_block();
+            reader = -1;
+        }
+        irq_restore(f);
+    }
+
+    char c = fifo[fifo_tail & (KBD_FIFO-1)];
+    fifo_tail++;
+    return c;
+}
@@ -1,25 +1,33 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "kalloc.h"
-#include "rtc.h"
-#include "kalloc.h"
 #include "paging.h"
 #include "task.h"
-
-#define HISTORY_MAX 10
-#define CMD_MAX_LEN 128
-
-static char history[HISTORY_MAX][CMD_MAX_LEN];
-static int history_count = 0;   // number of stored commands (<= HISTORY_MAX)
-static int history_start = 0;   // index of the oldest entry
-
-static void history_add(const char* cmd);
-static void history_print(void);
+#include "prof.h"
+#include "kmprof.h"
+#include "coro.h"
+#include "tsc.h"
+#include "math64.h"
+#include "bootinfo.h"
+#include "fbcon.h"
+#include "irq.h"
+#include "gdt.h"
+#include "syscall.h"
+#include "workq.h"
+#include "shell.h"
+#include "latency.h"
+#include "acpi.h"
+#include "top.h"
+#include "loader.h"
+#include "klog.h"
+#include "serial.h"
+#include "batch.h"
+#include "clock.h"
 
 void vga_clear(); void vga_write(const char*); void vga_writeln(const char*); void vga_putc(char);
-void vga_set_color(uint8_t); void vga_write_color(const char*, uint8_t);
+void vga_set_color(uint8_t); void vga_write_color(const char*, uint8_t); void vga_attach_fbcon(); void vga_mirror_serial(int);
+void vga_hold(void); void vga_release(void);
 char kbd_getch();
-void irq_init(); uint32_t timer_ticks();
 static inline void outb(uint16_t p, uint8_t v){ __asm__ volatile("outb %0,%1"::"a"(v),"Nd"(p)); }
 static inline void qemu_poweroff(){
     __asm__ volatile("outw %0,%1" :: "a"((uint16_t)0), "Nd"((uint16_t)0xF4));
@@ -32,37 +40,38 @@ static inline void cpuid(uint32_t leaf,uint32_t* a,uint32_t* b,uint32_t* c,uint3
     if(d)*d=D;
 }
 
-static size_t my_strlen(const char*s){size_t n=0;while(s[n])n++;return n;}
-static int my_streq(const char*a,const char*b){while(*a&&*b&&*a==*b){a++;b++;}return *a==0&&*b==0;}
-static int my_starts(const char*s,const char*p){while(*p){if(*s++!=*p++)return 0;}return 1;}
-static void utoa32(uint32_t x,char*b){char t[16];int i=0;if(x==0){b[0]='0';b[1]=0;return;}while(x){t[i++]='0'+(x%10u);x/=10u;}for(int j=0;j<i;j++)b[j]=t[i-1-j];b[i]=0;}
-static void hex8(uint32_t x,char*b){static const char h[16]="0123456789ABCDEF";for(int i=7;i>=0;i--){b[7-i]=h[(x>>(i*4))&0xF];}b[8]=0;}
-static void hex16_64(uint64_t x,char*b){ static const char h[16]="0123456789ABCDEF"; for(int i=15;i>=0;i--){ b[15-i]=h[(x>>(i*4))&0xF]; } b[16]=0; }
-
 static void prompt(){vga_write("> ");}
 
 static volatile int g_tasks_quiet = 0;
 
-/* Multiboot2 constants and structs */
-#define MULTIBOOT_TAG_TYPE_END 0
-#define MULTIBOOT_TAG_TYPE_MMAP 6
-
-struct mb2_tag { uint32_t type; uint32_t size; } __attribute__((packed));
-struct mb2_tag_mmap { uint32_t type; uint32_t size; uint32_t entry_size; uint32_t entry_version; } __attribute__((packed));
-struct mb2_mmap_entry {
-    uint64_t addr;
-    uint64_t len;
-    uint32_t type;
-    uint32_t reserved;
-} __attribute__((packed));
-
-/* helper prints */
-static void print_mmap_entry(struct mb2_mmap_entry *e){
-    char s[32];
-    hex16_64(e->addr, s); vga_write("base=0x"); vga_writeln(s);
-    hex16_64(e->len, s);  vga_write(" len =0x"); vga_writeln(s);
-    char tbuf[16]; utoa32(e->type, tbuf); vga_write(" type="); vga_writeln(tbuf);
-    vga_writeln("------------------------");
+/* boot-time profiling: rdtsc around each init step in kernel_main */
+#define BOOT_PHASES_MAX 12
+
+struct boot_phase {
+    const char *name;
+    uint64_t    cycles;
+};
+
+static struct boot_phase boot_phases[BOOT_PHASES_MAX];
+static int boot_nphases = 0;
+static uint64_t boot_tsc_start = 0;     /* kernel_main entry */
+static uint64_t boot_tsc_phase = 0;     /* start of the current phase */
+static uint64_t boot_tsc_prompt = 0;    /* first shell prompt */
+static int g_boot_quiet = 0;            /* `quiet` on the cmdline: no [dbg] lines */
+
+static void boot_phase_begin(void){ boot_tsc_phase = rdtsc(); }
+
+static void boot_phase_end(const char *name){
+    uint64_t now = rdtsc();
+    if(boot_nphases < BOOT_PHASES_MAX){
+        boot_phases[boot_nphases].name = name;
+        boot_phases[boot_nphases].cycles = now - boot_tsc_phase;
+        boot_nphases++;
+    }
+}
+
+static void dbg(const char *s){
+    if(!g_boot_quiet) vga_writeln(s);
 }
 
 static const char* mmap_type_name(uint32_t t){
@@ -77,103 +86,56 @@ static const char* mmap_type_name(uint32_t t){
 }
 
 
-/* mem summary: total usable bytes (type==1) and quick print */
-static void handle_mem_tag(uint32_t mbi_addr){
-    if(mbi_addr == 0){ vga_writeln("no multiboot info"); return; }
-    uint8_t *base = (uint8_t*)(uintptr_t)mbi_addr;
-    uint32_t total_size = *(uint32_t*)(base + 0);
-    if(total_size < 8){ vga_writeln("invalid mbi size"); return; }
-    uint8_t *tagp = base + 8;
-    uint8_t *endp = base + total_size;
-    uint64_t usable_bytes = 0;
-    vga_write("mbi total_size="); char tb[16]; utoa32(total_size,tb); vga_writeln(tb);
-    while(tagp + sizeof(struct mb2_tag) <= endp){
-        struct mb2_tag *tag = (struct mb2_tag*)tagp;
-        if(tag->type == MULTIBOOT_TAG_TYPE_END) break;
-        if(tag->size < 8) break;
-        if(tag->type == MULTIBOOT_TAG_TYPE_MMAP){
-            struct mb2_tag_mmap *mmaptag = (struct mb2_tag_mmap*)tag;
-            uint8_t *entryp = tagp + sizeof(struct mb2_tag_mmap);
-            while(entryp + mmaptag->entry_size <= tagp + tag->size){
-                struct mb2_mmap_entry *e = (struct mb2_mmap_entry*)entryp;
-                if(e->type == 1) usable_bytes += e->len;
-                entryp += mmaptag->entry_size;
-            }
-        }
-        tagp += (tag->size + 7) & ~7;
+static void write_cycles_us(uint64_t cycles){
+    char t[24];
+    shell_utoa32((uint32_t)cycles, t);
+    vga_write(t); vga_write(" cycles  ");
+    shell_utoa32((uint32_t)tsc_to_us(cycles), t);
+    vga_write(t); vga_writeln(" us");
+}
+
+static void boottime_print(void){
+    char t[16];
+    shell_utoa32(tsc_khz(), t);
+    vga_write("tsc: "); vga_write(t); vga_writeln(" kHz");
+    for(int i=0;i<boot_nphases;i++){
+        vga_write(boot_phases[i].name);
+        for(size_t k=shell_strlen(boot_phases[i].name); k<14; k++) vga_putc(' ');
+        write_cycles_us(boot_phases[i].cycles);
     }
+    if(boot_tsc_prompt){
+        vga_write("to prompt     ");
+        write_cycles_us(boot_tsc_prompt - boot_tsc_start);
+    }
+}
+
+/* mem summary: total usable bytes (type==1) and quick print */
+static void handle_mem_tag(void){
+    const struct bootinfo *bi = bootinfo_get();
+    if(bi->mbi_size == 0){ vga_writeln("no multiboot info"); return; }
+    vga_write("mbi total_size="); char tb[16]; shell_utoa32(bi->mbi_size,tb); vga_writeln(tb);
     /* print summary in MiB */
-    uint32_t mib = (uint32_t)(usable_bytes / (1024*1024));
-    char out[32]; utoa32(mib, out);
+    uint32_t mib = (uint32_t)(bi->usable_bytes >> 20);
+    char out[32]; shell_utoa32(mib, out);
     vga_write("Usable RAM: "); vga_write(out); vga_writeln(" MiB");
 }
 
-static void memmap_print(uint32_t mbi_addr){
-    if(mbi_addr == 0){
+static void memmap_print(void){
+    const struct bootinfo *bi = bootinfo_get();
+    if(bi->mbi_size == 0){
         vga_writeln("no multiboot info");
         return;
     }
 
-    uint8_t *base = (uint8_t*)(uintptr_t)mbi_addr;
-    uint32_t total_size = *(uint32_t*)(base + 0);
-    if(total_size < 8){
-        vga_writeln("invalid mbi size");
-        return;
-    }
-
-    uint8_t *tagp = base + 8;
-    uint8_t *endp = base + total_size;
-
     vga_writeln("Memory map entries:");
-    char idxbuf[16];
-    char hexbuf[32];
-    char decbuf[32];
-
-    int idx = 0;
-
-    while(tagp + sizeof(struct mb2_tag) <= endp){
-        struct mb2_tag *tag = (struct mb2_tag*)tagp;
-        if(tag->type == MULTIBOOT_TAG_TYPE_END) break;
-        if(tag->size < 8) break;
-
-        if(tag->type == MULTIBOOT_TAG_TYPE_MMAP){
-            struct mb2_tag_mmap *mmaptag = (struct mb2_tag_mmap*)tag;
-            uint8_t *entryp = tagp + sizeof(struct mb2_tag_mmap);
-
-            while(entryp + mmaptag->entry_size <= tagp + tag->size){
-                struct mb2_mmap_entry *e = (struct mb2_mmap_entry*)entryp;
-
-                idx++;
-                utoa32((uint32_t)idx, idxbuf);
-                vga_write("#"); vga_write(idxbuf); vga_write(": ");
-
-                // base
-                hex16_64(e->addr, hexbuf);
-                vga_write("base=0x"); vga_write(hexbuf);
-
-                // length
-                hex16_64(e->len, hexbuf);
-                vga_write(" len=0x"); vga_write(hexbuf);
-
-                // length in MiB (approx)
-                uint64_t mib = e->len / (1024*1024);
-                utoa32((uint32_t)mib, decbuf);
-                vga_write(" ("); vga_write(decbuf); vga_write(" MiB)");
-
-                // type
-                const char* name = mmap_type_name(e->type);
-                utoa32(e->type, decbuf);
-                vga_write(" type="); vga_write(decbuf); vga_write(" ");
-                vga_writeln(name);
-
-                entryp += mmaptag->entry_size;
-            }
-        }
-
-        tagp += (tag->size + 7) & ~7;
+    for(uint32_t i=0;i<bi->nmmap;i++){
+        const struct bootinfo_mmap *e = &bi->mmap[i];
+        kprintf("#%u: base=0x%016llX len=0x%016llX (%u MiB) type=%u %s\n", i+1,
+                (unsigned long long)e->addr, (unsigned long long)e->len,
+                (uint32_t)(e->len >> 20), e->type, mmap_type_name(e->type));
     }
 
-    if(idx == 0){
+    if(bi->nmmap == 0){
         vga_writeln("no mmap entries found");
     }
 }
@@ -185,9 +147,48 @@ static void cmd_cpuid(){
     char vendor[13]; ((uint32_t*)vendor)[0]=ebx;((uint32_t*)vendor)[1]=edx;((uint32_t*)vendor)[2]=ecx;vendor[12]=0;
     vga_write("vendor: "); vga_writeln(vendor);
     cpuid(1,&eax,&ebx,&ecx,&edx);
-    char t[16]; vga_write("eax: ");hex8(eax,t);vga_writeln(t);
-    vga_write("ecx: ");hex8(ecx,t);vga_writeln(t);
-    vga_write("edx: ");hex8(edx,t);vga_writeln(t);
+    char t[16]; vga_write("eax: ");shell_hex8(eax,t);vga_writeln(t);
+    vga_write("ecx: ");shell_hex8(ecx,t);vga_writeln(t);
+    vga_write("edx: ");shell_hex8(edx,t);vga_writeln(t);
+}
+
+/* console throughput: N full lines through vga_write, timed with rdtsc,
+   once flushed line by line and once batched with vga_hold */
+#define CONBENCH_LINES 200
+static uint64_t conbench_run(const char *line, int batched, struct fbcon_stats *st){
+    struct fbcon_stats s0;
+    fbcon_get_stats(&s0);
+    uint64_t t0 = rdtsc();
+    if(batched) vga_hold();
+    for(int i=0;i<CONBENCH_LINES;i++) vga_writeln(line);
+    if(batched) vga_release();
+    uint64_t cycles = rdtsc() - t0;
+    fbcon_get_stats(st);
+    st->scrolls -= s0.scrolls;
+    st->flushes -= s0.flushes;
+    st->full_flushes -= s0.full_flushes;
+    return cycles;
+}
+
+static void cmd_conbench(){
+    char line[72];
+    for(int i=0;i<70;i++) line[i] = (char)('!' + (i % 90));
+    line[70] = 0;
+
+    struct fbcon_stats st[2];
+    uint64_t cycles[2];
+    for(int b=0;b<2;b++) cycles[b] = conbench_run(line, b, &st[b]);
+
+    uint32_t bytes = CONBENCH_LINES * 71;
+    for(int b=0;b<2;b++){
+        uint32_t us = (uint32_t)tsc_to_us(cycles[b]);
+        kprintf("conbench %s: %u bytes in %u us", b ? "batched " : "per line", bytes, us);
+        if(us) kprintf(", %u KB/s", (uint32_t)div64_32((uint64_t)bytes * 1000u, us, 0));
+        kprintf(", %u cycles/line\n", (uint32_t)div64_32(cycles[b], CONBENCH_LINES, 0));
+        if(fbcon_active())
+            kprintf("  %u scrolls, %u flushes, %u full-screen (%u KiB each)\n",
+                    st[b].scrolls, st[b].flushes, st[b].full_flushes, st[b].screen_bytes >> 10);
+    }
 }
 
 static void sleep_ticks(uint32_t count){
@@ -196,23 +197,15 @@ static void sleep_ticks(uint32_t count){
     }
 }
 
-static void test_task(){
+static void test_task(void *arg){
+    (void)arg;
     uint32_t counter = 0;
     while(1){
         /* Only print if not muted, and not too often */
         if(!g_tasks_quiet){
             /* print once every 16 iterations to reduce spam */
-            if((counter & 0x1E) == 0){
-                int id = task_current_id();
-                char idbuf[16], cntbuf[16];
-                utoa32((uint32_t)id, idbuf);
-                utoa32(counter, cntbuf);
-
-                vga_write("[task ");
-                vga_write(idbuf);
-                vga_write("] tick ");
-                vga_writeln(cntbuf);
-            }
+            if((counter & 0x1E) == 0)
+                klog(KLOG_INFO, "[task %d] tick %u", task_current_id(), counter);
         }
 
         /* Do some work, but allow scheduler to preempt us */
@@ -226,137 +219,261 @@ static void test_task(){
 }
 
 
-static void run_cmd(const char* buf, uint32_t mbi_addr){
-    if(my_streq(buf,"help"))
-        vga_writeln("commands: help, echo <text>, clear, halt, uptime, cpuid, reboot, mem, memmap, alloc <n>, heap, kmstat, taskrun, tasks, tstat, tquiet, tverbose, switch, time, history, !!, poweroff");
+/* count timer and all interrupts over one second while the shell sleeps */
+static void nohz_measure(const char *label){
+    uint32_t t0 = timer_ticks(), i0 = irq_count(), c0 = timer_irq_count();
+    task_sleep(timer_hz());
+    uint32_t dt = timer_ticks() - t0, di = irq_count() - i0, dc = timer_irq_count() - c0;
+    kprintf("  %-8s timer interrupts/s: %u  all interrupts/s: %u  ticks: %u\n", label, dc, di, dt);
+}
+
+/* `nohz [on|off]`: switch the dynamic tick, then measure idle and with
+   one `taskrun` hog; with nohz on, neither should need periodic ticks */
+static void cmd_nohz(const char *arg){
+    while(*arg == ' ') arg++;
+    if(shell_streq(arg, "on") && timer_nohz_set(1) < 0) vga_writeln("nohz: TSC not usable");
+    if(shell_streq(arg, "off")) timer_nohz_set(0);
+
+    vga_write("nohz: ");
+    vga_writeln(timer_nohz_enabled() ? "on" : "off");
+    nohz_measure("idle");
+
+    int quiet = g_tasks_quiet;
+    g_tasks_quiet = 1;
+    int hog = task_create_ex(&(struct task_attrs){ .name = "taskrun", .entry = test_task });
+    if(hog >= 0){
+        nohz_measure("1 hog");
+        task_kill(hog);
+    }
+    g_tasks_quiet = quiet;
+}
+
+static void run_cmd(const char* buf){
+    if(shell_streq(buf,"help"))
+        vga_writeln("commands: help, echo <text>, clear, halt, uptime, cpuid, reboot, mem, memmap, alloc <n>, heap, kmstat, kmprof [reset], taskrun, tasks, coro [demo], corobench, tstat, tquiet, tverbose, switch, time [rtc], history, !!, prof start|stop|top, boottime, bootinfo, fbinfo, conbench, userrun, run [name], sysbench, wqstat, latency [n], intcstat, nohz [on|off], top, dmesg, poweroff");
 
-    else if(my_starts(buf,"echo "))
+    else if(shell_starts(buf,"echo "))
         vga_writeln(buf+5);
 
-    else if(my_streq(buf,"clear"))
+    else if(shell_streq(buf,"clear"))
         vga_clear();
 
-    else if(my_streq(buf,"halt")){
+    else if(shell_streq(buf,"halt")){
         vga_writeln("halting");
         for(;;)__asm__ volatile("hlt");
     }
 
-    else if(my_streq(buf,"uptime")){
+    else if(shell_streq(buf,"uptime")){
         char t[16];
-        utoa32(timer_ticks()/100u, t);
+        shell_utoa32(timer_ticks()/timer_hz(), t);
         vga_write("seconds: "); vga_writeln(t);
     }
 
-    else if(my_streq(buf,"cpuid"))
+    else if(shell_streq(buf,"cpuid"))
         cmd_cpuid();
 
-    else if(my_streq(buf,"reboot")){
+    else if(shell_streq(buf,"reboot")){
         vga_writeln("rebooting");
         for(;;){ outb(0x64, 0xFE); }
     }
 
-    else if(my_streq(buf,"mem"))
-        handle_mem_tag(mbi_addr);
+    else if(shell_streq(buf,"mem"))
+        handle_mem_tag();
+
+    else if(shell_streq(buf,"memmap"))
+        memmap_print();
+
+    else if(shell_streq(buf,"bootinfo"))
+        bootinfo_print();
 
-    else if(my_streq(buf,"memmap"))
-        memmap_print(mbi_addr);
+    else if(shell_streq(buf,"fbinfo"))
+        fbcon_info();
 
-    else if(my_starts(buf,"alloc ")){
-        uint32_t x = 0; 
-        const char *p = buf + 6;
-        while(*p >= '0' && *p <= '9'){ x = x * 10 + (*p - '0'); p++; }
+    else if(shell_streq(buf,"conbench"))
+        cmd_conbench();
+
+    else if(shell_starts(buf,"alloc ")){
+        uint32_t x = 0;
+        shell_parse_uint(buf + 6, &x);
         void *r = kmalloc(x);
         if(!r) vga_writeln("alloc failed");
         else {
             char h[16];
-            hex8((uint32_t)(uintptr_t)r, h);
+            shell_hex8((uint32_t)(uintptr_t)r, h);
             vga_write("allocated @ 0x"); 
             vga_writeln(h);
         }
     }
 
-    else if(my_streq(buf,"heap")){
+    else if(shell_streq(buf,"heap")){
         char h[16], s[16];
-        hex8(kalloc_get_start(), s);
-        hex8(kalloc_get_ptr(), h);
+        shell_hex8(kalloc_get_start(), s);
+        shell_hex8(kalloc_get_ptr(), h);
         vga_write("heap_start=0x"); vga_writeln(s);
         vga_write("heap_ptr  =0x"); vga_writeln(h);
     }
 
-    else if(my_streq(buf,"kmstat")){
+    else if(shell_streq(buf,"kmstat")){
         char h[16], d[16];
         uint32_t used = kalloc_bytes_used();
-        hex8(kalloc_get_start(), h); vga_write("heap_start=0x"); vga_writeln(h);
-        hex8(kalloc_get_ptr(),  h); vga_write("heap_ptr  =0x"); vga_writeln(h);
-        utoa32(used, d);           vga_write("used bytes="); vga_writeln(d);
+        shell_hex8(kalloc_get_start(), h); vga_write("heap_start=0x"); vga_writeln(h);
+        shell_hex8(kalloc_get_ptr(),  h); vga_write("heap_ptr  =0x"); vga_writeln(h);
+        shell_utoa32(used, d);           vga_write("used bytes="); vga_writeln(d);
     }
+
+    else if(shell_streq(buf,"kmprof"))
+        kmprof_print();
+
+    else if(shell_streq(buf,"kmprof reset"))
+        kmprof_clear();
     
-    else if(my_streq(buf,"taskrun"))
-        task_create(test_task);
+    else if(shell_streq(buf,"taskrun"))
+        task_create_ex(&(struct task_attrs){ .name = "taskrun", .entry = test_task });
 
-    else if(my_streq(buf,"tasks"))
+    else if(shell_streq(buf,"coro"))
+        coro_stats_print();
+
+    else if(shell_streq(buf,"coro demo"))
+        coro_demo();
+
+    else if(shell_streq(buf,"corobench"))
+        coro_bench();
+
+    else if(shell_streq(buf,"userrun"))
+        syscall_user_demo();
+
+    else if(shell_streq(buf,"run"))
+        prog_list();
+
+    else if(shell_starts(buf,"run "))
+        prog_run(buf + 4);
+
+    else if(shell_streq(buf,"sysbench"))
+        syscall_bench();
+
+    else if(shell_streq(buf,"wqstat"))
+        workq_stats_print();
+
+    else if(shell_streq(buf,"intcstat"))
+        irq_intc_stats_print();
+
+    else if(shell_starts(buf,"nohz"))
+        cmd_nohz(buf + 4);
+
+    else if(shell_streq(buf,"latency") || shell_starts(buf,"latency ")){
+        uint32_t hogs = 1;
+        shell_parse_uint(buf + 7, &hogs);
+        int quiet = g_tasks_quiet;
+        g_tasks_quiet = 1;          /* hogs must not print over the report */
+        latency_run(hogs, test_task);
+        g_tasks_quiet = quiet;
+    }
+
+    else if(shell_streq(buf,"tasks"))
         task_list();
     
-    else if(my_streq(buf,"tstat"))
+    else if(shell_streq(buf,"tstat"))
         task_stats_print();
+
+    else if(shell_streq(buf,"top"))
+        top_run();
     
-    else if(my_streq(buf,"tquiet")){
+    else if(shell_streq(buf,"tquiet")){
         g_tasks_quiet = 1;
         vga_writeln("task output muted");
     }
 
-    else if(my_streq(buf,"tverbose")){
+    else if(shell_streq(buf,"tverbose")){
         g_tasks_quiet = 0;
         vga_writeln("task output enabled");
     }
     
-    else if(my_streq(buf,"switch"))
+    else if(shell_streq(buf,"switch"))
         task_yield();
         
-    else if(my_streq(buf,"time")){
-        struct rtc_time t;
-        rtc_read(&t);
-        char tmp[16];
-        vga_write("Time: ");
-        utoa32(t.hour, tmp); vga_write(tmp); vga_putc(':');
-        utoa32(t.min, tmp);  vga_write(tmp); vga_putc(':');
-        utoa32(t.sec, tmp);  vga_write(tmp);
-
-        vga_write("  Date: ");
-        utoa32(t.day, tmp); vga_write(tmp); vga_putc('/');
-        utoa32(t.month, tmp); vga_write(tmp); vga_putc('/');
-        utoa32(t.year, tmp); vga_writeln(tmp);
-    }
+    else if(shell_streq(buf,"time"))
+        clock_print();
+
+    else if(shell_streq(buf,"time rtc"))
+        clock_rtc_compare();
 
-    else if(my_streq(buf,"history"))
+    else if(shell_streq(buf,"history"))
         history_print();
 
-    else if(my_streq(buf,"!!")){
-        if(history_count == 0) vga_writeln("no history");
+    else if(shell_streq(buf,"boottime"))
+        boottime_print();
+
+    else if(shell_streq(buf,"prof start"))
+        prof_start();
+
+    else if(shell_streq(buf,"prof stop"))
+        prof_stop();
+
+    else if(shell_streq(buf,"prof top"))
+        prof_top();
+
+    else if(shell_streq(buf,"!!")){
+        const char *last = history_last();
+        if(!last) vga_writeln("no history");
         else {
-            int idx = (history_start + history_count - 1) % HISTORY_MAX;
-            vga_write("> "); vga_writeln(history[idx]);  // display command
-            run_cmd(history[idx], mbi_addr);            // 🔥 RE-EXECUTE
+            vga_write("> "); vga_writeln(last);  // display command
+            run_cmd(last);            // 🔥 RE-EXECUTE
         }
     }
 
-    else if(my_streq(buf,"poweroff")){
+    else if(shell_streq(buf,"dmesg"))
+        klog_dmesg();
+
+    else if(shell_streq(buf,"poweroff")){
         vga_writeln("powering off...");
         qemu_poweroff();
     }
 
-    else if(my_strlen(buf) > 0)
+    else if(shell_strlen(buf) > 0)
         vga_writeln("unknown");
 }
 
-/* store Multiboot info globally so shell_task can access it */
-static uint32_t g_mbi_addr = 0;
+/* Batch mode: `batch="cmd; cmd"` runs the commands given inline,
+   `batch=@name` the script in boot module `name` (see batch.h). */
+static void batch_exec(const char *cmd){
+    run_cmd(cmd);
+    klog_flush();
+}
+
+static void batch_sleep(uint32_t ms){
+    task_sleep((uint32_t)div64_32((uint64_t)ms * timer_hz() + 999, 1000, 0));
+}
+
+static int batch_mode(void){
+    const char *opt = bootinfo_opt("batch");
+    if(!opt) return 0;
+    const char *script = opt;
+    uint32_t len = (uint32_t)shell_strlen(opt);
+    if(opt[0] == '@'){
+        const struct bootinfo_module *m = bootinfo_module_find(opt + 1);
+        if(!m){ kprintf("[batch] no module '%s'\n", opt + 1); return 1; }
+        script = (const char*)(uintptr_t)m->start;
+        len = m->end - m->start;
+    }
+    /* the serial line is what a scripted QEMU run captures */
+    vga_mirror_serial(1);
+    kprintf("[batch] start (%s)\n", opt);
+    batch_run(script, len, &(struct batch_ops){ batch_exec, batch_sleep });
+    return 1;
+}
 
 /* Shell as a TASK: same logic as previous inline shell loop but no longer in kernel_main */
-static void shell_task(void){
+static void shell_task(void *arg){
+    (void)arg;
     char buf[128]; size_t n = 0;
+    boot_phase_end("first switch");
+    if(batch_mode()){
+        vga_writeln("powering off...");
+        qemu_poweroff();
+    }
     vga_writeln("mini-os shell");
     prompt();
+    boot_tsc_prompt = rdtsc();
 
     for(;;){
         char c = kbd_getch();
@@ -368,13 +485,13 @@ static void shell_task(void){
             buf[n]=0;
             vga_putc('\n');
 
-            if(my_strlen(buf) > 0 && !my_streq(buf,"history") && !my_streq(buf,"!!")){
+            if(shell_strlen(buf) > 0 && !shell_streq(buf,"history") && !shell_streq(buf,"!!")){
                 history_add(buf);
             }
 
-            /* use global mbi addr */
-            run_cmd(buf, g_mbi_addr);
+            run_cmd(buf);
             n = 0;
+            klog_flush();       /* log lines from the command before the prompt */
             prompt();
         }
         else if(c==8){
@@ -388,8 +505,14 @@ static void shell_task(void){
 
 
 void kernel_main(uint32_t mbi_addr){
-    /* store mbi for shell/task commands */
-    g_mbi_addr = mbi_addr;
+    boot_tsc_start = rdtsc();
+
+    /* index the Multiboot2 info before anything can overwrite it */
+    boot_phase_begin();
+    bootinfo_init(mbi_addr);
+    boot_phase_end("bootinfo_init");
+    g_boot_quiet = bootinfo_opt("quiet") != 0;
+    serial_init();
 
     /* start: clear and banner */
     vga_set_color(0x0F);
@@ -399,76 +522,93 @@ void kernel_main(uint32_t mbi_addr){
     vga_writeln("               ITI Patna OS                   ");
     vga_writeln("==============================================");
     vga_set_color(0x0F);
-    vga_writeln("[dbg] after banner");
+    dbg("[dbg] after banner");
+
+    /* own GDT + TSS (segments for ring 3) */
+    boot_phase_begin();
+    gdt_init();
+    boot_phase_end("gdt_init");
 
-    /* IRQs / IDT / PIT */
+    /* IRQs / IDT / PIT, system call entry points */
+    boot_phase_begin();
+    workq_init();
     irq_init();
-    vga_writeln("[dbg] after irq_init");
+    syscall_init();
+    boot_phase_end("irq_init");
+    dbg("[dbg] after irq_init");
+
+    /* MADT, read by physical address while paging is still off */
+    boot_phase_begin();
+    acpi_init();
+    boot_phase_end("acpi_init");
     __asm__ volatile("sti");
-    vga_writeln("[dbg] after sti");
+    dbg("[dbg] after sti");
 
-    /* heap */
-    kalloc_init(0x01000000);
-    vga_writeln("[dbg] after kalloc_init");
+    /* heap: above 16 MiB and above any boot modules */
+    boot_phase_begin();
+    uint32_t heap_start = 0x01000000;
+    if(bootinfo_get()->modules_end > heap_start)
+        heap_start = (bootinfo_get()->modules_end + 0xFFF) & ~0xFFFu;
+    kalloc_init(heap_start);
+    boot_phase_end("kalloc_init");
+    dbg("[dbg] after kalloc_init");
 
     /* paging */
+    boot_phase_begin();
     paging_init();
-    vga_writeln("[dbg] after paging_init");
+    loader_init();
+    boot_phase_end("paging_init");
+    dbg("[dbg] after paging_init");
+
+    /* LAPIC/I/O APIC if present (maps their registers) */
+    boot_phase_begin();
+    irq_select_intc();
+    boot_phase_end("intc");
+    dbg("[dbg] after irq_select_intc");
+
+    /* wall clock: one RTC read, optional IRQ8 resync */
+    boot_phase_begin();
+    clock_init();
+    boot_phase_end("clock_init");
+    dbg("[dbg] after clock_init");
+
+    /* graphics console, if GRUB gave us a 32 bpp linear framebuffer */
+    boot_phase_begin();
+    if(fbcon_init()) vga_attach_fbcon();
+    boot_phase_end("fbcon_init");
+    dbg("[dbg] after fbcon_init");
 
     /* task system */
+    boot_phase_begin();
     task_init();
-    vga_writeln("[dbg] after task_init");
+    boot_phase_end("task_init");
+    dbg("[dbg] after task_init");
 
     /* create shell task (first) */
-    vga_writeln("[dbg] about to create shell task");
-    task_create(shell_task);
-    vga_writeln("[dbg] after create shell task");
+    dbg("[dbg] about to create shell task");
+    task_create_ex(&(struct task_attrs){ .name = "shell", .stack_size = 8192, .entry = shell_task });
+    dbg("[dbg] after create shell task");
+
+    /* worker task for deferred (non-softirq) work */
+    task_create_ex(&(struct task_attrs){ .name = "kworker", .entry = workq_worker });
+
+    /* drains the log ring to VGA and serial */
+    task_create_ex(&(struct task_attrs){ .name = "klogd", .entry = klogd });
+
+    /* runs every coroutine (coro.h) */
+    task_create_ex(&(struct task_attrs){ .name = "corod", .entry = coro_sched });
 
     /* don't auto-create demo tasks here (create with `taskrun`) */
 
-    /* final: switch into task world */
-    vga_writeln("[dbg] about to switch to first task");
+    /* `nohz` on the cmdline: start with the dynamic tick */
+    if(bootinfo_opt("nohz")) timer_nohz_set(1);
+
+    /* final: switch into task world (phase ends when shell_task starts) */
+    dbg("[dbg] about to switch to first task");
+    boot_phase_begin();
     task_switch_first();
 
     /* if we ever return, halt and print message */
     vga_writeln("[dbg] returned from task_switch_first (unexpected)");
     for(;;) __asm__ volatile("hlt");
 }
-
-
-static void history_add(const char* cmd){
-    size_t len = my_strlen(cmd);
-    if(len == 0) return; // don't store empty lines
-
-    if(len >= CMD_MAX_LEN) len = CMD_MAX_LEN-1;
-
-    int idx;
-    if(history_count < HISTORY_MAX){
-        idx = (history_start + history_count) % HISTORY_MAX;
-        history_count++;
-    } else {
-        // overwrite oldest
-        idx = history_start;
-        history_start = (history_start + 1) % HISTORY_MAX;
-    }
-
-    for(size_t i=0;i<len;i++) history[idx][i] = cmd[i];
-    history[idx][len] = 0;
-}
-
-static void history_print(){
-    if(history_count == 0){
-        vga_writeln("no history");
-        return;
-    }
-    char num[16];
-    for(int i=0;i<history_count;i++){
-        int idx = (history_start + i) % HISTORY_MAX;
-        utoa32((uint32_t)(i+1), num);
-        vga_write(num);
-        vga_write(": ");
-        vga_writeln(history[idx]);
-    }
-}
-
-
@@ -0,0 +1,242 @@
+#include "klog.h"
+#include "task.h"
+#include "tsc.h"
+#include "math64.h"
+#include "serial.h"
+#include "io.h"
+#include <stdint.h>
+
+extern void vga_write(const char* s);
+extern void vga_writeln(const char* s);
+extern int  vga_mirrors_serial(void);
+extern void vga_hold(void);
+extern void vga_release(void);
+
+/* ---- formatter ---- */
+
+struct out {
+    char  *buf;
+    size_t n;       /* capacity including the NUL */
+    size_t len;     /* characters produced so far (may exceed n) */
+};
+
+static void emit(struct out *o, char c){
+    if(o->len + 1 < o->n) o->buf[o->len] = c;
+    o->len++;
+}
+
+static void emit_pad(struct out *o, char c, int count){
+    while(count-- > 0) emit(o, c);
+}
+
+static void emit_num(struct out *o, uint64_t v, uint32_t base, int upper, int neg,
+                     int width, int zero, int left){
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char t[24]; int i = 0;
+    do {
+        uint32_t r;
+        if(base == 16){ r = (uint32_t)v & 0xF; v >>= 4; }
+        else v = div64_32(v, base, &r);
+        t[i++] = digits[r];
+    } while(v);
+
+    int pad = width - i - neg;
+    if(!left && !zero) emit_pad(o, ' ', pad);
+    if(neg) emit(o, '-');
+    if(!left && zero) emit_pad(o, '0', pad);
+    while(i) emit(o, t[--i]);
+    if(left) emit_pad(o, ' ', pad);
+}
+
+int kvsnprintf(char *buf, size_t n, const char *fmt, va_list ap){
+    struct out o = { buf, n, 0 };
+    for(; *fmt; fmt++){
+        if(*fmt != '%'){ emit(&o, *fmt); continue; }
+        fmt++;
+        int left = 0, zero = 0, width = 0, lng = 0;
+        for(;; fmt++){
+            if(*fmt == '-') left = 1;
+            else if(*fmt == '0') zero = 1;
+            else break;
+        }
+        while(*fmt >= '0' && *fmt <= '9') width = width*10 + (*fmt++ - '0');
+        while(*fmt == 'l'){ lng++; fmt++; }
+
+        switch(*fmt){
+        case 'd': case 'i': {
+            int64_t v = lng >= 2 ? va_arg(ap, long long) : lng ? va_arg(ap, long) : va_arg(ap, int);
+            uint64_t u = v < 0 ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+            emit_num(&o, u, 10, 0, v < 0, width, zero, left);
+            break;
+        }
+        case 'u': case 'x': case 'X': {
+            uint64_t v = lng >= 2 ? va_arg(ap, unsigned long long)
+                       : lng ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int);
+            emit_num(&o, v, *fmt == 'u' ? 10 : 16, *fmt == 'X', 0, width, zero, left);
+            break;
+        }
+        case 'p':
+            emit(&o, '0'); emit(&o, 'x');
+            emit_num(&o, (uintptr_t)va_arg(ap, void*), 16, 0, 0, 8, 1, 0);
+            break;
+        case 'c':
+            if(!left) emit_pad(&o, ' ', width - 1);
+            emit(&o, (char)va_arg(ap, int));
+            if(left) emit_pad(&o, ' ', width - 1);
+            break;
+        case 's': {
+            const char *s = va_arg(ap, const char*);
+            if(!s) s = "(null)";
+            int len = 0; while(s[len]) len++;
+            if(!left) emit_pad(&o, ' ', width - len);
+            while(*s) emit(&o, *s++);
+            if(left) emit_pad(&o, ' ', width - len);
+            break;
+        }
+        case '%':
+            emit(&o, '%');
+            break;
+        case 0:
+            fmt--;          /* lone '%' at the end */
+            break;
+        default:
+            emit(&o, '%'); emit(&o, *fmt);
+            break;
+        }
+    }
+    if(n) buf[o.len < n ? o.len : n - 1] = 0;
+    return (int)o.len;
+}
+
+int ksnprintf(char *buf, size_t n, const char *fmt, ...){
+    va_list ap;
+    va_start(ap, fmt);
+    int r = kvsnprintf(buf, n, fmt, ap);
+    va_end(ap);
+    return r;
+}
+
+int kprintf(const char *fmt, ...){
+    char b[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int r = kvsnprintf(b, sizeof(b), fmt, ap);
+    va_end(ap);
+    vga_write(b);
+    return r;
+}
+
+/* ---- log ring ----
+   Producers reserve a sequence number with a CAS on `head`, fill the slot
+   and publish it by storing seq+1 into `commit`. A reservation that would
+   overwrite a record the console has not written yet fails instead, so
+   slot reuse never races the reader. A producer interrupted between its
+   reservation and commit (by an IRQ that also logs) just makes the reader
+   stop at that slot until the commit lands. */
+
+#define KLOG_MASK (KLOG_RECORDS - 1)
+
+struct klog_rec {
+    volatile uint32_t commit;       /* seq + 1 once the record is complete */
+    uint8_t  level;
+    uint16_t task;
+    uint64_t tsc;
+    char     text[KLOG_TEXT];
+};
+
+static struct klog_rec ring[KLOG_RECORDS];
+static volatile uint32_t head;          /* next sequence number to reserve */
+static volatile uint32_t tail;          /* next sequence number for the console */
+static volatile uint32_t logged, dropped;
+static int console_level = KLOG_INFO;
+static volatile int klogd_id, klogd_waiting;
+
+void klog(int level, const char *fmt, ...){
+    uint32_t seq = head;
+    do {
+        if(seq - tail >= KLOG_RECORDS){
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while(!__atomic_compare_exchange_n(&head, &seq, seq + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    struct klog_rec *r = &ring[seq & KLOG_MASK];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(r->text, KLOG_TEXT, fmt, ap);
+    va_end(ap);
+    if(n > KLOG_TEXT - 1) n = KLOG_TEXT - 1;
+    if(n > 0 && r->text[n-1] == '\n') r->text[--n] = 0;     /* records are lines */
+    r->level = (uint8_t)level;
+    r->task  = (uint16_t)task_current_id();
+    r->tsc   = rdtsc();
+    __atomic_store_n(&r->commit, seq + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&logged, 1, __ATOMIC_RELAXED);
+
+    if(klogd_waiting){
+        klogd_waiting = 0;
+        task_wake(klogd_id);
+    }
+}
+
+void klog_set_console_level(int level){ console_level = level; }
+
+/* single reader: klogd, or the shell via klog_flush; both run in task
+   context and the scheduler never switches in the middle of a drain */
+static uint32_t drain(uint32_t max){
+    uint32_t n = 0;
+    vga_hold();                             /* one framebuffer flush per batch */
+    while(n < max && tail != head){
+        const struct klog_rec *r = &ring[tail & KLOG_MASK];
+        if(r->commit != tail + 1) break;
+        if(r->level <= console_level){
+            vga_writeln(r->text);
+            if(!vga_mirrors_serial()){      /* else vga_writeln already did */
+                serial_write(r->text);
+                serial_putc('\n');
+            }
+        }
+        __atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+        n++;
+    }
+    vga_release();
+    return n;
+}
+
+uint32_t klog_flush(void){
+    return drain(0xFFFFFFFFu);
+}
+
+void klogd(void *arg){
+    (void)arg;
+    klogd_id = task_current_id();
+    for(;;){
+        uint32_t f = irq_save();
+        if(tail == head){
+            klogd_waiting = 1;
+            task_block();
+        }
+        irq_restore(f);
+        /* let the other tasks run between batches */
+        while(drain(KLOG_BATCH) == KLOG_BATCH) task_yield();
+    }
+}
+
+void klog_dmesg(void){
+    uint32_t end = head;
+    uint32_t start = end - (end < KLOG_RECORDS ? end : KLOG_RECORDS);
+    for(uint32_t s = start; s != end; s++){
+        const struct klog_rec *r = &ring[s & KLOG_MASK];
+        if(r->commit != s + 1) continue;    /* overwritten or still being written */
+        uint32_t usec;
+        uint32_t sec = (uint32_t)div64_32(tsc_to_us(r->tsc), 1000000u, &usec);
+        kprintf("[%5u.%06u] %c %3u %s\n", sec, usec, "EWID"[r->level & 3], r->task, r->text);
+    }
+    kprintf("%u logged, %u dropped, %u pending\n", logged, dropped, head - tail);
+}
+
+void klog_get_stats(struct klog_stats *s){
+    s->logged  = logged;
+    s->dropped = dropped;
+    s->pending = head - tail;
+}
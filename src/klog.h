@@ -0,0 +1,51 @@
+#ifndef KLOG_H
+#define KLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+/* Formatted output. Conversions: %d %i %u %x %X %c %s %p %%, with the
+   flags '-' and '0', a field width, and the l / ll length modifiers. */
+int  kvsnprintf(char *buf, size_t n, const char *fmt, va_list ap);
+int  ksnprintf(char *buf, size_t n, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+/* synchronous: straight to the console, for interactive command output */
+int  kprintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/* Kernel log. klog() formats into a lock-free ring of fixed-size records
+   (level, TSC timestamp, task id) and returns without touching the
+   console; safe from IRQ context. When the ring is full the message is
+   dropped and counted. The klogd task writes records at or below the
+   console level to VGA and serial in batches; every record stays in the
+   ring for `dmesg` until it is overwritten. */
+#define KLOG_ERR     0
+#define KLOG_WARN    1
+#define KLOG_INFO    2
+#define KLOG_DEBUG   3
+
+#define KLOG_RECORDS 128            /* power of two */
+#define KLOG_TEXT    112            /* bytes per message, including the NUL */
+#define KLOG_BATCH   32             /* records written per klogd pass */
+
+void klog(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+void klog_set_console_level(int level);
+
+/* write every pending record now (shell prompt, panics); returns the count */
+uint32_t klog_flush(void);
+
+/* console task: waits for records, then drains them KLOG_BATCH at a time */
+void klogd(void *arg);
+
+/* replay the ring with timestamps and levels */
+void klog_dmesg(void);
+
+struct klog_stats {
+    uint32_t logged;        /* records committed */
+    uint32_t dropped;       /* ring full */
+    uint32_t pending;       /* committed, not yet on the console */
+};
+void klog_get_stats(struct klog_stats *s);
+
+#endif
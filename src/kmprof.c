@@ -0,0 +1,84 @@
+#include "kmprof.h"
+#include "kalloc.h"
+#include "ksyms.h"
+#include "klog.h"
+#include <stdint.h>
+
+#ifdef KALLOC_TRACE
+
+#define KMPROF_TOP_N      12
+#define KMPROF_SHOW_RECENT 6
+
+static const char* site_name(uint32_t site, uint32_t *off){
+    const char *n = ksym_lookup(site, off);
+    if(!n){ *off = site; return "?"; }
+    return n;
+}
+
+static void print_task(int task){
+    if(task == KMPROF_MANY_TASKS) kprintf(" many");
+    else if(task < 0) kprintf(" boot");
+    else kprintf(" %4d", task);
+}
+
+void kmprof_print(void){
+    uint32_t lost;
+    const struct kmprof_site *s = kmprof_sites(&lost);
+
+    /* indices of the used slots, largest byte total first */
+    uint8_t idx[KMPROF_SITES];
+    uint32_t n = 0, total = 0, count = 0;
+    for(uint32_t i=0;i<KMPROF_SITES;i++){
+        if(!s[i].count) continue;
+        total += s[i].bytes; count += s[i].count;
+        uint32_t j = n++;
+        while(j > 0 && s[idx[j-1]].bytes < s[i].bytes){ idx[j] = idx[j-1]; j--; }
+        idx[j] = (uint8_t)i;
+    }
+    if(n == 0){
+        kprintf("no allocations recorded\n");
+        return;
+    }
+
+    kprintf("%u allocations, %u bytes from %u sites", count, total, n);
+    if(lost) kprintf(" (+%u from sites that did not fit)", lost);
+    kprintf("\n    bytes count task  <=16  <=64 <=256  <=1K  <=4K <=16K <=64K  >64K site\n");
+    for(uint32_t k=0;k<n && k<KMPROF_TOP_N;k++){
+        const struct kmprof_site *e = &s[idx[k]];
+        uint32_t off;
+        const char *name = site_name(e->site, &off);
+        kprintf("%9u %5u", e->bytes, e->count);
+        print_task(e->task);
+        for(uint32_t b=0;b<KMPROF_BUCKETS;b++) kprintf(" %5u", e->hist[b]);
+        kprintf(" %s+0x%x\n", name, off);
+    }
+    if(n > KMPROF_TOP_N) kprintf("  ... %u more sites\n", n - KMPROF_TOP_N);
+
+    struct kmprof_rec r[KMPROF_SHOW_RECENT];
+    int nr = kmprof_recent(r, KMPROF_SHOW_RECENT);
+    kprintf("last allocations:\n");
+    for(int i=0;i<nr;i++){
+        uint32_t off;
+        const char *name = site_name(r[i].site, &off);
+        kprintf("  0x%08x %7u bytes task", r[i].addr, r[i].size);
+        print_task(r[i].task);
+        kprintf("  %s+0x%x\n", name, off);
+    }
+}
+
+void kmprof_clear(void){
+    kmprof_reset();
+    kprintf("allocation profile cleared\n");
+}
+
+#else
+
+void kmprof_print(void){
+    kprintf("kmprof: allocation tracing is not built in (make KALLOC_TRACE=1)\n");
+}
+
+void kmprof_clear(void){
+    kmprof_print();
+}
+
+#endif
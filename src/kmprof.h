@@ -0,0 +1,10 @@
+#ifndef KMPROF_H
+#define KMPROF_H
+
+/* `kmprof`: heap usage per allocation site, from the KALLOC_TRACE
+   instrumentation in kalloc.c. Without that build flag both commands
+   only say how to enable it. */
+void kmprof_print(void);
+void kmprof_clear(void);
+
+#endif
@@ -0,0 +1,21 @@
+#include "ksyms.h"
+#include <stdint.h>
+
+/* binary search for the last symbol with addr <= a */
+int ksym_index(uint32_t a){
+    if(ksyms_count == 0 || a < ksyms_table[0].addr) return -1;
+    uint32_t lo = 0, hi = ksyms_count;
+    while(hi - lo > 1){
+        uint32_t mid = (lo + hi) / 2;
+        if(ksyms_table[mid].addr <= a) lo = mid;
+        else hi = mid;
+    }
+    return (int)lo;
+}
+
+const char* ksym_lookup(uint32_t a, uint32_t *offset){
+    int i = ksym_index(a);
+    if(i < 0) return 0;
+    if(offset) *offset = a - ksyms_table[i].addr;
+    return ksyms_table[i].name;
+}
@@ -0,0 +1,22 @@
+#ifndef KSYMS_H
+#define KSYMS_H
+#include <stdint.h>
+
+/* Kernel symbol table.
+   The table itself is generated at link time from `nm -n build/kernel.elf`
+   (see the Makefile) and contains the text symbols sorted by address. */
+struct ksym {
+    uint32_t addr;
+    const char *name;
+};
+
+extern const struct ksym ksyms_table[];
+extern const uint32_t ksyms_count;
+
+/* index of the symbol containing addr, or -1 */
+int ksym_index(uint32_t addr);
+
+/* name of the symbol containing addr (or 0); *offset = addr - symbol start */
+const char* ksym_lookup(uint32_t addr, uint32_t *offset);
+
+#endif
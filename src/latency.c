@@ -0,0 +1,183 @@
+#include "latency.h"
+#include "task.h"
+#include "irq.h"
+#include "tsc.h"
+#include "math64.h"
+#include "shell.h"
+#include <stdint.h>
+
+extern void vga_writeln(const char* s);
+extern void vga_write(const char* s);
+
+#define LAT_SAMPLES   200       /* wakeups per phase */
+#define LAT_STAMPS    16        /* power of two; ticks of exact timer history */
+#define LAT_MAX_HOGS  8
+
+void lat_hist_reset(struct lat_hist *h){
+    h->count = 0;
+    h->min_ns = 0xFFFFFFFFu;
+    h->max_ns = 0;
+    h->sum_ns = 0;
+    for(int i=0;i<LAT_BUCKETS;i++) h->bucket[i] = 0;
+}
+
+void lat_hist_add(struct lat_hist *h, uint32_t ns){
+    int b = ns ? 31 - __builtin_clz(ns) : 0;
+    h->bucket[b]++;
+    h->count++;
+    h->sum_ns += ns;
+    if(ns < h->min_ns) h->min_ns = ns;
+    if(ns > h->max_ns) h->max_ns = ns;
+}
+
+uint32_t lat_hist_percentile(const struct lat_hist *h, uint32_t pct){
+    if(h->count == 0) return 0;
+    uint64_t need = (uint64_t)h->count * pct;   /* compare cum*100 >= count*pct */
+    uint64_t cum = 0;
+    for(int b=0;b<LAT_BUCKETS;b++){
+        cum += h->bucket[b];
+        if(cum * 100u >= need){
+            uint32_t hi = b == 31 ? 0xFFFFFFFFu : (2u << b) - 1u;
+            return hi < h->max_ns ? hi : h->max_ns;
+        }
+    }
+    return h->max_ns;
+}
+
+uint32_t lat_hist_avg(const struct lat_hist *h){
+    if(h->count == 0) return 0;
+    return (uint32_t)div64_32(h->sum_ns, h->count, 0);
+}
+
+/* ---- measurement ---- */
+
+volatile int latency_active = 0;
+/* TSC at ISR entry of the last LAT_STAMPS ticks; tsc 0 = not recorded */
+static volatile uint64_t tick_tsc[LAT_STAMPS];
+static volatile uint32_t tick_no[LAT_STAMPS];
+static uint32_t tick_cycles;                    /* TSC cycles per timer tick */
+static struct lat_hist wake_hist, irq_hist;
+static volatile int lat_done;
+
+static void record_stamp(uint32_t tick, uint64_t tsc){
+    uint32_t s = tick & (LAT_STAMPS-1);
+    tick_tsc[s] = 0;                            /* the pair is invalid while it changes */
+    tick_no[s] = tick;
+    tick_tsc[s] = tsc;
+}
+
+void latency_on_timer(uint32_t tick){
+    record_stamp(tick, rdtsc());
+    lat_hist_add(&irq_hist, timer_irq_delay_ns());
+}
+
+/* TSC at the ISR entry of tick t: its own stamp while it is still in the
+   history, else extrapolated by whole tick periods from the nearest stamp
+   (a wakeup many ticks late, or a tick the dynamic tick skipped) */
+static uint64_t tick_stamp(uint32_t t){
+    uint64_t best = 0;
+    uint32_t best_dist = 0xFFFFFFFFu;
+    for(uint32_t i=0;i<LAT_STAMPS;i++){
+        uint64_t tsc = tick_tsc[i];
+        uint32_t no = tick_no[i];
+        if(!tsc || tick_tsc[i] != tsc) continue;
+        int32_t d = (int32_t)(t - no);
+        uint32_t dist = d < 0 ? (uint32_t)-d : (uint32_t)d;
+        if(dist < best_dist){
+            best_dist = dist;
+            best = tsc + (int64_t)d * tick_cycles;
+        }
+    }
+    return best;
+}
+
+/* sleep one tick at a time; latency = run time - ISR entry of the waking tick */
+static void latency_task(void *arg){
+    (void)arg;
+    for(int i=0;i<LAT_SAMPLES;i++){
+        uint32_t target = task_sleep(1);
+        uint64_t now = rdtsc();
+        uint64_t expected = tick_stamp(target);
+        uint64_t ns = now > expected ? tsc_to_ns(now - expected) : 0;
+        lat_hist_add(&wake_hist, ns > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)ns);
+    }
+    lat_done = 1;
+    task_exit();
+}
+
+static void print_pad(const char *s, int width){
+    int n = 0;
+    while(s[n]) n++;
+    while(n++ < width) vga_write(" ");
+    vga_write(s);
+}
+
+static void print_row(const char *label, const struct lat_hist *h){
+    char t[16];
+    vga_write(label);
+    if(h->count == 0){ vga_writeln("   no samples"); return; }
+    shell_utoa32(h->min_ns, t);                    print_pad(t, 10);
+    shell_utoa32(lat_hist_avg(h), t);              print_pad(t, 10);
+    shell_utoa32(lat_hist_percentile(h, 99), t);   print_pad(t, 10);
+    shell_utoa32(h->max_ns, t);                    print_pad(t, 10);
+    vga_writeln("");
+
+    /* non-empty buckets as log2(ns):count */
+    vga_write("      log2 ns:");
+    for(int b=0;b<LAT_BUCKETS;b++){
+        if(!h->bucket[b]) continue;
+        vga_write(" ");
+        shell_utoa32((uint32_t)b, t); vga_write(t);
+        vga_write(":");
+        shell_utoa32(h->bucket[b], t); vga_write(t);
+    }
+    vga_writeln("");
+}
+
+static void latency_phase(const char *name){
+    lat_hist_reset(&wake_hist);
+    lat_hist_reset(&irq_hist);
+    for(int i=0;i<LAT_STAMPS;i++) tick_tsc[i] = 0;
+    lat_done = 0;
+    tick_cycles = (uint32_t)div64_32((uint64_t)tsc_khz() * 1000u, timer_hz(), 0);
+
+    latency_active = 1;
+    if(task_create_ex(&(struct task_attrs){ .name = "latency", .entry = latency_task }) < 0){
+        latency_active = 0;
+        return;
+    }
+    while(!lat_done) task_sleep(10);
+    latency_active = 0;
+
+    vga_writeln(name);
+    print_row("  wake", &wake_hist);
+    print_row("  irq ", &irq_hist);
+}
+
+void latency_run(uint32_t hogs, void (*hog)(void *arg)){
+    int ids[LAT_MAX_HOGS];
+    char t[16];
+    if(hogs > LAT_MAX_HOGS) hogs = LAT_MAX_HOGS;
+
+    shell_utoa32(LAT_SAMPLES, t);
+    vga_write("latency: "); vga_write(t);
+    vga_writeln(" one-tick wakeups per phase, ns");
+    vga_writeln("               min       avg       p99       max");
+    latency_phase("no load");
+
+    if(hogs == 0) return;
+    uint32_t n = 0;
+    for(uint32_t i=0;i<hogs;i++){
+        int id = task_create_ex(&(struct task_attrs){ .name = "hog", .entry = hog });
+        if(id >= 0) ids[n++] = id;
+    }
+    char name[24];
+    shell_utoa32(n, name);
+    int k = 0;
+    while(name[k]) k++;
+    const char *sfx = n == 1 ? " hog" : " hogs";
+    for(int j=0; sfx[j]; j++) name[k++] = sfx[j];
+    name[k] = 0;
+    latency_phase(name);
+    for(uint32_t i=0;i<n;i++) task_kill(ids[i]);
+}
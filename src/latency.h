@@ -0,0 +1,34 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+#include <stdint.h>
+
+/* cyclictest-style latency measurement.
+   A measurement task sleeps one tick at a time and records how late it
+   runs after the timer interrupt that woke it; the timer ISR records
+   its own delivery delay from the PIT counter. Both go into log2(ns)
+   histograms. */
+
+#define LAT_BUCKETS 32          /* bucket b: [2^b, 2^(b+1)) ns; 0 also holds 0 */
+
+struct lat_hist {
+    uint32_t count;
+    uint32_t min_ns, max_ns;
+    uint64_t sum_ns;
+    uint32_t bucket[LAT_BUCKETS];
+};
+
+void     lat_hist_reset(struct lat_hist *h);
+void     lat_hist_add(struct lat_hist *h, uint32_t ns);
+/* upper bound of the bucket holding the pct-th percentile, capped at max */
+uint32_t lat_hist_percentile(const struct lat_hist *h, uint32_t pct);
+uint32_t lat_hist_avg(const struct lat_hist *h);
+
+/* set while a measurement runs; the timer ISR then calls latency_on_timer */
+extern volatile int latency_active;
+void latency_on_timer(uint32_t tick);
+
+/* `latency [N]`: measure with no load, then with N copies of `hog`
+   running; the hogs are killed afterwards */
+void latency_run(uint32_t hogs, void (*hog)(void *arg));
+
+#endif
@@ -0,0 +1,235 @@
+#include "loader.h"
+#include "elf.h"
+#include "paging.h"
+#include "kalloc.h"
+#include "task.h"
+#include "irq.h"
+#include "tsc.h"
+#include "bootinfo.h"
+#include "klog.h"
+#include <stdint.h>
+
+extern void vga_writeln(const char* s);
+
+#define PAGE_SIZE       4096u
+#define PAGE_MASK       (PAGE_SIZE-1)
+#define IDMAP_END       0x02000000u     /* modules must sit in the identity map */
+#define PF_VECTOR       14
+#define PF_ERR_PRESENT  0x1             /* protection fault, not a missing page */
+#define LAZY_MAX        (ELF_MAX_PHDRS + 1)
+
+#define KIB(pages)      ((pages) * (PAGE_SIZE/1024))
+
+/* address range backed by zero pages allocated on first touch */
+struct lazy_range {
+    uint32_t start, end;    /* page aligned */
+    uint32_t flags;
+};
+
+struct prog {
+    int      task_id;       /* 0 = free slot */
+    char     name[16];
+    uint32_t *dir;
+    struct lazy_range lazy[LAZY_MAX];
+    int      nlazy;
+    uint32_t pages_shared;  /* module frames mapped in place */
+    uint32_t pages_copied;  /* private copies of file data */
+    uint32_t pages_zeroed;  /* faulted in from a lazy range */
+    uint32_t lazy_pages;    /* reserved, not yet resident */
+};
+
+static struct prog progs[PROG_MAX];
+
+static struct prog* prog_find(int id){
+    if(id <= 0) return 0;
+    for(int i=0;i<PROG_MAX;i++) if(progs[i].task_id == id) return &progs[i];
+    return 0;
+}
+
+/* Frames come from the bump heap (inside the identity map), so they can be
+   filled through their physical address; they are not reclaimed on exit. */
+static uint8_t* page_alloc_zero(void){
+    uint8_t *pg = (uint8_t*)kmalloc_aligned(PAGE_SIZE, PAGE_SIZE);
+    if(pg) for(uint32_t i=0;i<PAGE_SIZE;i++) pg[i] = 0;
+    return pg;
+}
+
+static int lazy_add(struct prog *p, uint32_t start, uint32_t end, uint32_t flags){
+    if(start >= end) return 0;
+    if(p->nlazy == LAZY_MAX) return -1;
+    p->lazy[p->nlazy].start = start;
+    p->lazy[p->nlazy].end   = end;
+    p->lazy[p->nlazy].flags = flags;
+    p->nlazy++;
+    p->lazy_pages += (end - start) / PAGE_SIZE;
+    return 0;
+}
+
+/* Map one PT_LOAD segment. File-backed pages of a read-only segment whose
+   file offset and address agree modulo the page size point straight at the
+   module; other file-backed pages are copied (a writable mapping of
+   the module would change it for the next `run`), and pages past the file
+   data are left for the fault handler. */
+static int map_segment(struct prog *p, const uint8_t *img, const struct elf32_phdr *ph){
+    uint32_t flags    = PAGE_USER | ((ph->p_flags & PF_W) ? PAGE_RW : 0);
+    uint32_t file_end = ph->p_vaddr + ph->p_filesz;
+    uint32_t mem_end  = (ph->p_vaddr + ph->p_memsz + PAGE_MASK) & ~PAGE_MASK;
+    uint32_t img_phys = (uint32_t)(uintptr_t)img;
+    int in_place = !(ph->p_flags & PF_W) && !(img_phys & PAGE_MASK)
+                && (ph->p_offset & PAGE_MASK) == (ph->p_vaddr & PAGE_MASK);
+
+    uint32_t va = ph->p_vaddr & ~PAGE_MASK;
+    for(; va < file_end; va += PAGE_SIZE){
+        /* a partial last page can be shared unless .bss starts inside it */
+        if(in_place && (va + PAGE_SIZE <= file_end || ph->p_filesz == ph->p_memsz)){
+            uint32_t pa = img_phys + ph->p_offset - (ph->p_vaddr - va);
+            if(paging_map_page(p->dir, va, pa, flags)) return -1;
+            p->pages_shared++;
+            continue;
+        }
+        uint8_t *pg = page_alloc_zero();
+        if(!pg) return -1;
+        uint32_t from = va < ph->p_vaddr ? ph->p_vaddr : va;
+        uint32_t to   = va + PAGE_SIZE < file_end ? va + PAGE_SIZE : file_end;
+        const uint8_t *src = img + ph->p_offset + (from - ph->p_vaddr);
+        for(uint32_t a = from; a < to; a++) pg[a - va] = *src++;
+        if(paging_map_page(p->dir, va, (uint32_t)(uintptr_t)pg, flags)) return -1;
+        p->pages_copied++;
+    }
+    return lazy_add(p, va, mem_end, flags);
+}
+
+static const struct lazy_range* lazy_find(const struct prog *p, uint32_t addr){
+    for(int i=0;i<p->nlazy;i++)
+        if(addr >= p->lazy[i].start && addr < p->lazy[i].end) return &p->lazy[i];
+    return 0;
+}
+
+/* #PF with the error code pushed by the CPU above the pusha frame */
+struct pf_frame {
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;
+    uint32_t err, eip, cs, eflags;
+};
+
+void page_fault_isr(struct pf_frame *f){
+    uint32_t addr;
+    __asm__ volatile("mov %%cr2, %0" : "=r"(addr));
+
+    /* kernel code may also touch lazy pages, e.g. SYS_WRITE from .bss */
+    struct prog *p = prog_find(task_current_id());
+    if(p && !(f->err & PF_ERR_PRESENT)){
+        const struct lazy_range *r = lazy_find(p, addr);
+        if(r){
+            uint8_t *pg = page_alloc_zero();
+            if(pg && paging_map_page(p->dir, addr & ~PAGE_MASK, (uint32_t)(uintptr_t)pg, r->flags) == 0){
+                p->pages_zeroed++;
+                p->lazy_pages--;
+                return;
+            }
+        }
+    }
+
+    /* a bad user pointer passed to a syscall kills the task, not the kernel */
+    int user_addr = addr >= PAGING_USER_BASE && addr < PAGING_USER_END;
+    if((f->cs & 3) || (user_addr && task_current_is_user())){
+        klog(KLOG_ERR, "page fault at 0x%08x eip=0x%08x err=%u in task %d, killed",
+             addr, f->eip, f->err, task_current_id());
+        prog_exit(task_current_id());
+        task_exit();
+    }
+    klog(KLOG_ERR, "page fault at 0x%08x eip=0x%08x err=%u in kernel, halting", addr, f->eip, f->err);
+    klog_flush();
+    for(;;) __asm__ volatile("cli; hlt");
+}
+
+__attribute__((naked)) void page_fault_stub(void){
+    __asm__ volatile(
+        "pusha\n"
+        "push %esp\n"
+        "call page_fault_isr\n"
+        "add $4, %esp\n"
+        "popa\n"
+        "add $4, %esp\n"            /* drop the error code */
+        "iret\n"
+    );
+}
+
+void loader_init(void){
+    irq_set_gate(PF_VECTOR, page_fault_stub, IDT_GATE_INT);
+}
+
+int prog_run(const char *name){
+    const struct bootinfo_module *m = bootinfo_module_find(name);
+    if(!m){ kprintf("run: no module '%s'\n", name); return -1; }
+    if(m->end > IDMAP_END){ vga_writeln("run: module outside the identity map"); return -1; }
+
+    struct prog *p = 0;
+    for(int i=0;i<PROG_MAX;i++) if(!progs[i].task_id){ p = &progs[i]; break; }
+    if(!p){ vga_writeln("run: too many programs"); return -1; }
+
+    uint64_t t0 = rdtsc();
+    const uint8_t *img = (const uint8_t*)(uintptr_t)m->start;
+    const char *err = 0;
+    uint32_t stack_lo = PAGING_USER_END - PROG_STACK_SIZE;
+    if(elf_check(img, m->end - m->start, PAGING_USER_BASE, stack_lo, &err)){
+        kprintf("run: %s: %s\n", name, err);
+        return -1;
+    }
+
+    const struct elf32_ehdr *eh = (const struct elf32_ehdr*)img;
+    int k = 0;
+    for(; name[k] && k < (int)sizeof(p->name)-1; k++) p->name[k] = name[k];
+    p->name[k] = 0;
+    p->nlazy = 0;
+    p->pages_shared = p->pages_copied = p->pages_zeroed = p->lazy_pages = 0;
+    p->dir = paging_new_dir();
+    if(!p->dir){ vga_writeln("run: out of memory"); return -1; }
+
+    /* segments must not share pages: a later copy would hide the earlier one */
+    uint32_t prev_end = 0;
+    int nseg = 0;
+    for(int i=0;i<eh->e_phnum;i++){
+        const struct elf32_phdr *ph = elf_phdr(img, i);
+        if(ph->p_type != PT_LOAD) continue;
+        if((ph->p_vaddr & ~PAGE_MASK) < prev_end){ vga_writeln("run: segments share a page"); return -1; }
+        if(map_segment(p, img, ph)){ vga_writeln("run: out of memory"); return -1; }
+        prev_end = (ph->p_vaddr + ph->p_memsz + PAGE_MASK) & ~PAGE_MASK;
+        nseg++;
+    }
+    if(lazy_add(p, stack_lo, PAGING_USER_END, PAGE_USER | PAGE_RW)){
+        vga_writeln("run: too many segments"); return -1;
+    }
+
+    /* fault handlers look the slot up by task id, so claim it before the
+       task can run; the scheduler only switches at the next yield */
+    int id = task_create_user_at(p->name, eh->e_entry, PAGING_USER_END - 16, p->dir);
+    if(id < 0) return -1;
+    p->task_id = id;
+    uint64_t us = tsc_to_us(rdtsc() - t0);
+
+    kprintf("run: %s task %d, loaded in %u us: %d segments, %u KiB in place, %u KiB copied, %u KiB lazy\n",
+            p->name, id, (uint32_t)us, nseg, KIB(p->pages_shared), KIB(p->pages_copied), KIB(p->lazy_pages));
+    return id;
+}
+
+void prog_exit(int id){
+    struct prog *p = prog_find(id);
+    if(!p) return;
+    klog(KLOG_INFO, "%s (task %d) exited: resident %u KiB (%u KiB shared, %u KiB zero-filled on touch)",
+         p->name, id, KIB(p->pages_shared + p->pages_copied + p->pages_zeroed),
+         KIB(p->pages_shared), KIB(p->pages_zeroed));
+    p->task_id = 0;
+}
+
+void prog_list(void){
+    const struct bootinfo *bi = bootinfo_get();
+    kprintf("modules:");
+    for(uint32_t i=0;i<bi->nmodules;i++) kprintf(" %s", bi->modules[i].name);
+    kprintf(bi->nmodules ? "\n" : " none\n");
+    for(int i=0;i<PROG_MAX;i++){
+        struct prog *p = &progs[i];
+        if(!p->task_id) continue;
+        kprintf("  task %d %s: resident %u KiB, %u KiB not yet touched\n", p->task_id, p->name,
+                KIB(p->pages_shared + p->pages_copied + p->pages_zeroed), KIB(p->lazy_pages));
+    }
+}
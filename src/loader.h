@@ -0,0 +1,25 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdint.h>
+
+/* Programs are ELF32 executables passed as Multiboot2 modules
+   (`module2 /boot/hello.elf hello` in grub.cfg) and linked at or above
+   PAGING_USER_BASE. Each runs as a ring-3 task in its own page directory. */
+
+#define PROG_MAX        8
+#define PROG_STACK_SIZE (64u*1024u)     /* user stack below PAGING_USER_END */
+
+/* install the page-fault handler (after paging_init) */
+void loader_init(void);
+
+/* load module `name` and start it as a task; returns the task id or -1 */
+int  prog_run(const char *name);
+
+/* list modules and running programs with their resident memory */
+void prog_list(void);
+
+/* report and release the program slot of task `id` (SYS_EXIT, faults) */
+void prog_exit(int id);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef MATH64_H
+#define MATH64_H
+#include <stdint.h>
+
+/* 64-bit by 32-bit unsigned division without libgcc (__udivdi3).
+   Two chained 64/32 `divl`s; the high quotient can never overflow. */
+static inline uint64_t div64_32(uint64_t n, uint32_t d, uint32_t *rem){
+    uint32_t hi = (uint32_t)(n >> 32), lo = (uint32_t)n;
+    uint32_t qhi = hi / d, r = hi % d, qlo;
+    __asm__("divl %4" : "=a"(qlo), "=d"(r) : "0"(lo), "1"(r), "rm"(d));
+    if(rem) *rem = r;
+    return ((uint64_t)qhi << 32) | qlo;
+}
+
+#endif
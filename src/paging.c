@@ -1,35 +1,45 @@
 #include <stdint.h>
-
-#define PAGE_PRESENT 0x001
-#define PAGE_RW      0x002
-#define PAGE_USER    0x004
+#include "paging.h"
+#include "kalloc.h"
 
 #define PAGE_SIZE    4096
 #define NUM_TABLES   8      // 8 * 4 MiB = 32 MiB identity-mapped
 
-__attribute__((aligned(4096)))
-static uint32_t page_directory[1024];
+/* The identity map is the same on every boot, so it is built by the
+   preprocessor into initialized .data instead of by a loop at runtime.
+   linker.ld places .data.pgtables first in .data, page aligned. */
+/* supervisor-only: ring 3 gets just the pages paging_map_identity later
+   marks PAGE_USER (the .user section, user stacks) */
+#define PTE(i)      ((uint32_t)(i) * PAGE_SIZE | PAGE_PRESENT | PAGE_RW)
+#define PTE_4(b)    PTE(b), PTE((b)+1), PTE((b)+2), PTE((b)+3)
+#define PTE_16(b)   PTE_4(b), PTE_4((b)+4), PTE_4((b)+8), PTE_4((b)+12)
+#define PTE_64(b)   PTE_16(b), PTE_16((b)+16), PTE_16((b)+32), PTE_16((b)+48)
+#define PTE_256(b)  PTE_64(b), PTE_64((b)+64), PTE_64((b)+128), PTE_64((b)+192)
+#define PTE_1024(b) PTE_256(b), PTE_256((b)+256), PTE_256((b)+512), PTE_256((b)+768)
 
-__attribute__((aligned(4096)))
-static uint32_t page_tables[NUM_TABLES][1024];
+__attribute__((aligned(4096), section(".data.pgtables")))
+static uint32_t page_tables[NUM_TABLES][1024] = {
+    { PTE_1024(0*1024) }, { PTE_1024(1*1024) }, { PTE_1024(2*1024) }, { PTE_1024(3*1024) },
+    { PTE_1024(4*1024) }, { PTE_1024(5*1024) }, { PTE_1024(6*1024) }, { PTE_1024(7*1024) },
+};
 
-void paging_init(void){
-    // clear directory
-    for(int i=0;i<1024;i++) page_directory[i] = 0;
+/* PDE for each 4 MiB chunk; the table addresses are link-time constants.
+   PAGE_USER here only lets individual PTEs opt in. */
+#define PDE(t)      ((uint32_t)page_tables[t] + (PAGE_PRESENT | PAGE_RW | PAGE_USER))
 
-    uint32_t flags = PAGE_PRESENT | PAGE_RW;
+__attribute__((aligned(4096), section(".data.pgtables")))
+static uint32_t page_directory[1024] = {
+    PDE(0), PDE(1), PDE(2), PDE(3), PDE(4), PDE(5), PDE(6), PDE(7),
+};
 
-    // identity-map first 32 MiB
-    for(int t=0;t<NUM_TABLES;t++){
-        uint32_t pt_phys = (uint32_t)page_tables[t];
-        page_directory[t] = pt_phys | flags;   // PDE for 4 MiB chunk
+static uint32_t *active_dir = page_directory;
 
-        for(int i=0;i<1024;i++){
-            uint32_t page_index = t*1024 + i;          // page number
-            uint32_t addr       = page_index * PAGE_SIZE; // physical addr
-            page_tables[t][i] = addr | flags;          // PTE
-        }
-    }
+extern char __user_start[], __user_end[];      /* linker.ld */
+
+void paging_init(void){
+    /* static tables cover the .user section, so this cannot fail */
+    paging_map_identity((uint32_t)__user_start, (uint32_t)(__user_end - __user_start),
+                        PAGE_USER | PAGE_RW);
 
     // load directory into CR3
     __asm__ volatile("mov %0, %%cr3" :: "r"(page_directory));
@@ -40,3 +50,62 @@ void paging_init(void){
     cr0 |= 0x80000000u; // set PG bit
     __asm__ volatile("mov %0, %%cr0" :: "r"(cr0));
 }
+
+int paging_map_identity(uint32_t addr, uint32_t len, uint32_t flags){
+    uint32_t start = addr & ~(uint32_t)(PAGE_SIZE-1);
+    uint64_t end   = ((uint64_t)addr + len + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE-1);
+
+    for(uint64_t a = start; a < end; a += PAGE_SIZE){
+        uint32_t pdi = (uint32_t)(a >> 22), pti = (uint32_t)(a >> 12) & 0x3FF;
+        if(!(page_directory[pdi] & PAGE_PRESENT)){
+            uint32_t *pt = (uint32_t*)kmalloc_aligned(PAGE_SIZE, PAGE_SIZE);
+            if(!pt) return -1;
+            for(int i=0;i<1024;i++) pt[i] = 0;
+            page_directory[pdi] = (uint32_t)pt | PAGE_PRESENT | PAGE_RW | (flags & PAGE_USER);
+        }
+        uint32_t *pt = (uint32_t*)(page_directory[pdi] & ~0xFFFu);
+        pt[pti] = (uint32_t)a | flags | PAGE_PRESENT;
+        __asm__ volatile("invlpg (%0)" :: "r"((uint32_t)a) : "memory");
+    }
+    return 0;
+}
+
+int paging_user_range(uint32_t addr, uint32_t len){
+    if(!len) return 1;
+    for(uint32_t pg = addr >> 12; pg <= (addr + len - 1) >> 12; pg++){
+        uint32_t pde = active_dir[pg >> 10];
+        if((pde & (PAGE_PRESENT | PAGE_USER)) != (PAGE_PRESENT | PAGE_USER)) return 0;
+        uint32_t pte = ((uint32_t*)(pde & ~0xFFFu))[pg & 0x3FF];
+        if((pte & (PAGE_PRESENT | PAGE_USER)) != (PAGE_PRESENT | PAGE_USER)) return 0;
+    }
+    return 1;
+}
+
+uint32_t* paging_new_dir(void){
+    uint32_t *dir = (uint32_t*)kmalloc_aligned(PAGE_SIZE, PAGE_SIZE);
+    if(!dir) return 0;
+    /* kernel mappings made after this point are not seen by the copy */
+    for(int i=0;i<1024;i++) dir[i] = page_directory[i];
+    return dir;
+}
+
+int paging_map_page(uint32_t *dir, uint32_t va, uint32_t pa, uint32_t flags){
+    uint32_t pdi = va >> 22, pti = (va >> 12) & 0x3FF;
+    if(!(dir[pdi] & PAGE_PRESENT)){
+        uint32_t *pt = (uint32_t*)kmalloc_aligned(PAGE_SIZE, PAGE_SIZE);
+        if(!pt) return -1;
+        for(int i=0;i<1024;i++) pt[i] = 0;
+        dir[pdi] = (uint32_t)pt | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+    }
+    uint32_t *pt = (uint32_t*)(dir[pdi] & ~0xFFFu);
+    pt[pti] = (pa & ~0xFFFu) | flags | PAGE_PRESENT;
+    if(dir == active_dir) __asm__ volatile("invlpg (%0)" :: "r"(va) : "memory");
+    return 0;
+}
+
+void paging_switch(uint32_t *dir){
+    if(!dir) dir = page_directory;
+    if(dir == active_dir) return;
+    active_dir = dir;
+    __asm__ volatile("mov %0, %%cr3" :: "r"(dir) : "memory");
+}
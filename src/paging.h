@@ -1,6 +1,43 @@
 #ifndef PAGING_H
 #define PAGING_H
 
+#include <stdint.h>
+
+#define PAGE_PRESENT 0x001
+#define PAGE_RW      0x002
+#define PAGE_USER    0x004
+#define PAGE_PWT     0x008
+#define PAGE_PCD     0x010
+
 void paging_init(void);
 
+/* Kernel-linked code and data that ring-3 tasks from task_create_user run
+   or touch. linker.ld gathers these sections into page-aligned
+   [__user_start, __user_end), which paging_init maps PAGE_USER; the rest
+   of the identity map is supervisor-only. Such code cannot call into
+   kernel text or use string literals (.rodata). */
+#define USER_TEXT   __attribute__((section(".user.text")))
+#define USER_RODATA __attribute__((section(".user.rodata")))
+#define USER_DATA   __attribute__((section(".user.data")))
+
+/* identity-map [addr, addr+len) with the given PTE flags; page tables for
+   4 MiB chunks outside the static map come from the kernel heap.
+   Returns 0 on success, -1 if a page table could not be allocated. */
+int paging_map_identity(uint32_t addr, uint32_t len, uint32_t flags);
+
+/* Per-program address spaces: the kernel PDEs are shared, user pages live
+   in [PAGING_USER_BASE, PAGING_USER_END) above the identity map. */
+#define PAGING_USER_BASE 0x40000000u
+#define PAGING_USER_END  0xC0000000u
+
+/* 1 if every page of [addr, addr+len) is present and PAGE_USER in the
+   active directory; the range must not wrap */
+int paging_user_range(uint32_t addr, uint32_t len);
+
+uint32_t* paging_new_dir(void);                 /* 0 if out of memory */
+/* map one page va -> pa in `dir`; -1 if a page table could not be allocated */
+int  paging_map_page(uint32_t *dir, uint32_t va, uint32_t pa, uint32_t flags);
+/* load `dir` into CR3 if it is not already active; 0 = kernel directory */
+void paging_switch(uint32_t *dir);
+
 #endif
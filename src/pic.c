@@ -0,0 +1,125 @@
+#include "intc.h"
+#include "io.h"
+#include "tsc.h"
+#include "math64.h"
+#include <stdint.h>
+
+/* Legacy backend: 8259 master/slave pair remapped to vectors 0x20-0x2F,
+   PIT channel 0 as the periodic tick on IRQ0. */
+
+#define PIT_HZ 1193182u
+
+static uint8_t pic_mask_master = 0xFF, pic_mask_slave = 0xFF;
+static uint16_t pit_reload;
+static int pit_oneshot;
+
+static int pic_init(void){
+    outb(0x20,0x11);
+    outb(0xA0,0x11);
+    outb(0x21,0x20);
+    outb(0xA1,0x28);
+    outb(0x21,0x04);
+    outb(0xA1,0x02);
+    outb(0x21,0x01);
+    outb(0xA1,0x01);
+    pic_disable();
+    return 0;
+}
+
+void pic_disable(void){
+    pic_mask_master = pic_mask_slave = 0xFF;
+    outb(0x21,0xFF);
+    outb(0xA1,0xFF);
+}
+
+static void pic_unmask(int irq){
+    if(irq < 8){
+        pic_mask_master &= (uint8_t)~(1u << irq);
+        outb(0x21, pic_mask_master);
+    } else {
+        pic_mask_slave &= (uint8_t)~(1u << (irq - 8));
+        pic_mask_master &= (uint8_t)~(1u << 2);     /* cascade */
+        outb(0xA1, pic_mask_slave);
+        outb(0x21, pic_mask_master);
+    }
+}
+
+static void pic_eoi(int irq){
+    if(irq >= 8) outb(0xA0, 0x20);
+    outb(0x20, 0x20);
+}
+
+/* mode 2 (rate generator): the count falls by one per input clock and
+   IRQ0 fires as it wraps, so the current count tells how long ago it fired */
+static void pit_timer_start(uint32_t hz){
+    uint16_t div = (uint16_t)(PIT_HZ / hz);
+    pit_reload = div;
+    pit_oneshot = 0;
+    outb(0x43,0x34);
+    outb(0x40,div & 0xFF);
+    outb(0x40,div >> 8);
+    pic_unmask(0);
+}
+
+/* mode 0 (interrupt on terminal count) fires once. The count is 16 bits
+   (~54 ms); a later deadline fires early and the caller re-arms. */
+static void pit_timer_oneshot(uint64_t tsc){
+    uint64_t now = rdtsc();
+    uint32_t clocks = 1;
+    if(tsc > now){
+        uint64_t c = div64_32(tsc_to_ns(tsc - now), 838u, 0) + 1;
+        clocks = c > 0xFFFF ? 0xFFFF : (uint32_t)c;
+    }
+    pit_oneshot = 1;
+    outb(0x43,0x30);
+    outb(0x40,clocks & 0xFF);
+    outb(0x40,clocks >> 8);
+}
+
+static uint32_t pit_timer_delay_ns(void){
+    outb(0x43, 0x00);                   /* latch channel 0 */
+    uint16_t lo = inb(0x40);
+    uint16_t cnt = (uint16_t)(lo | (inb(0x40) << 8));
+    if(pit_oneshot) return (uint32_t)(uint16_t)(0u - cnt) * 838u;   /* wrapped past 0 */
+    if(cnt > pit_reload) return 0;
+    return (uint32_t)(pit_reload - cnt) * 838u;     /* ~838.1 ns per PIT clock */
+}
+
+static const char* pit_timer_mode(void){ return pit_oneshot ? "PIT one-shot" : "PIT periodic"; }
+
+/* Channel 2 is gated through port 0x61 and does not raise an IRQ, so
+   this works with interrupts on or off and leaves the tick alone. */
+static uint8_t ch2_gate;
+
+void pit_ch2_start(uint32_t ms){
+    uint16_t count = (uint16_t)(PIT_HZ * ms / 1000u);
+
+    ch2_gate = inb(0x61);
+    outb(0x61, (ch2_gate & ~0x02) & ~0x01);   /* speaker off, gate low */
+    outb(0x43, 0xB0);                         /* ch2, lo/hi, mode 0 */
+    outb(0x42, count & 0xFF);
+    outb(0x42, count >> 8);
+    outb(0x61, (ch2_gate & ~0x02) | 0x01);    /* gate high: start counting */
+}
+
+void pit_ch2_wait(void){
+    while(!(inb(0x61) & 0x20)) { }            /* OUT2 goes high at terminal count */
+    outb(0x61, ch2_gate);
+}
+
+void pit_delay_ms(uint32_t ms){
+    pit_ch2_start(ms);
+    pit_ch2_wait();
+}
+
+const struct intc intc_pic = {
+    .name           = "8259 PIC",
+    .init           = pic_init,
+    .unmask         = pic_unmask,
+    .eoi            = pic_eoi,
+    .timer_start    = pit_timer_start,
+    .timer_oneshot  = pit_timer_oneshot,
+    .timer_ack      = 0,
+    .timer_delay_ns = pit_timer_delay_ns,
+    .timer_mode     = pit_timer_mode,
+};
@@ -0,0 +1,215 @@
+#include "prof.h"
+#include "ksyms.h"
+#include "task.h"
+#include "kalloc.h"
+#include "shell.h"
+#include <stdint.h>
+
+extern void vga_writeln(const char* s);
+extern void vga_write(const char* s);
+
+#define PROF_MAX_SAMPLES 8192
+#define PROF_TOP_N       12
+#define PROF_SPLIT_TASKS 16     /* tasks named in the per-task line */
+
+#ifdef PROF_CALLCHAIN
+#define PROF_CHAIN_DEPTH 4
+#endif
+
+struct prof_sample {
+    uint32_t eip;
+    int      task;
+#ifdef PROF_CALLCHAIN
+    uint32_t chain[PROF_CHAIN_DEPTH];   /* return addresses, 0-terminated */
+#endif
+};
+
+static struct prof_sample samples[PROF_MAX_SAMPLES];
+static volatile uint32_t nsamples = 0;
+static volatile uint32_t dropped = 0;
+static volatile int enabled = 0;
+
+/* scratch for prof_top: a slot per symbol, then one for [unknown].
+   Taken from the heap on first use; ksyms_count is fixed per image. */
+static uint32_t *self_hits;
+#ifdef PROF_CALLCHAIN
+static uint32_t *incl_hits;
+#endif
+
+/* print v right-aligned in a field of width w */
+static void write_padded(uint32_t v, int w){
+    char b[16]; shell_utoa32(v, b);
+    int len = 0; while(b[len]) len++;
+    for(int i=len;i<w;i++) vga_write(" ");
+    vga_write(b);
+}
+
+void prof_start(void){
+    enabled = 0;
+    nsamples = 0;
+    dropped = 0;
+    enabled = 1;
+    vga_writeln("profiling started");
+}
+
+void prof_stop(void){
+    enabled = 0;
+    char n[16]; shell_utoa32(nsamples, n);
+    vga_write("profiling stopped, samples="); vga_writeln(n);
+}
+
+#ifdef PROF_CALLCHAIN
+/* frames must live in the identity-mapped low 32 MiB and grow upwards */
+static int frame_ok(uint32_t fp, uint32_t prev){
+    return fp > prev && (fp & 3) == 0 && fp >= 0x100000u && fp < 0x02000000u - 8;
+}
+#endif
+
+void prof_sample(uint32_t eip, uint32_t ebp){
+    if(!enabled) return;
+    if(nsamples >= PROF_MAX_SAMPLES){ dropped++; return; }
+
+    struct prof_sample *s = &samples[nsamples];
+    s->eip  = eip;
+    s->task = task_current_id();
+#ifdef PROF_CALLCHAIN
+    uint32_t fp = ebp, prev = 0;
+    int d = 0;
+    while(d < PROF_CHAIN_DEPTH && frame_ok(fp, prev)){
+        uint32_t *frame = (uint32_t*)(uintptr_t)fp;
+        s->chain[d++] = frame[1];
+        prev = fp;
+        fp = frame[0];
+    }
+    if(d < PROF_CHAIN_DEPTH) s->chain[d] = 0;
+#else
+    (void)ebp;
+#endif
+    nsamples++;
+}
+
+static uint32_t sym_slot(uint32_t addr){
+    int i = ksym_index(addr);
+    if(i < 0 || (uint32_t)i >= ksyms_count) return ksyms_count;
+    return (uint32_t)i;
+}
+
+static const char* slot_name(uint32_t slot){
+    if(slot >= ksyms_count) return "[unknown]";
+    return ksyms_table[slot].name;
+}
+
+/* per-task sample counts, printed as one line; samples from tasks past
+   the first PROF_SPLIT_TASKS are summed on a line of their own */
+static void print_task_split(uint32_t n){
+    int seen[PROF_SPLIT_TASKS]; uint32_t cnt[PROF_SPLIT_TASKS]; int ntasks = 0;
+    int more[4 * PROF_SPLIT_TASKS]; int nmore = 0;
+    uint32_t rest = 0;
+    for(uint32_t i=0;i<n;i++){
+        int t = samples[i].task, j;
+        for(j=0;j<ntasks;j++) if(seen[j] == t) break;
+        if(j == ntasks){
+            if(ntasks == PROF_SPLIT_TASKS){
+                rest++;
+                for(j=0;j<nmore;j++) if(more[j] == t) break;
+                if(j == nmore && nmore < (int)(sizeof more / sizeof more[0])) more[nmore++] = t;
+                continue;
+            }
+            seen[ntasks] = t; cnt[ntasks] = 0; ntasks++;
+        }
+        cnt[j]++;
+    }
+    char b[16];
+    vga_write("per task:");
+    for(int j=0;j<ntasks;j++){
+        vga_write(" [");
+        if(seen[j] < 0) vga_write("none");
+        else { shell_utoa32((uint32_t)seen[j], b); vga_write(b); }
+        vga_write("]=");
+        shell_utoa32((cnt[j] * 100u) / n, b); vga_write(b); vga_write("%");
+    }
+    vga_writeln("");
+    if(rest){
+        vga_write("  +"); shell_utoa32(rest, b); vga_write(b);
+        vga_write(" samples from ");
+        if(nmore == (int)(sizeof more / sizeof more[0])) vga_write("at least ");
+        shell_utoa32((uint32_t)nmore, b); vga_write(b);
+        vga_writeln(" more tasks");
+    }
+}
+
+void prof_top(void){
+    uint32_t n = nsamples;
+    if(n == 0){
+        vga_writeln("no samples (use `prof start`)");
+        return;
+    }
+
+    if(!self_hits){
+        self_hits = (uint32_t*)kmalloc((ksyms_count + 1) * sizeof(uint32_t));
+#ifdef PROF_CALLCHAIN
+        incl_hits = (uint32_t*)kmalloc((ksyms_count + 1) * sizeof(uint32_t));
+        if(!incl_hits) self_hits = 0;
+#endif
+        if(!self_hits){ vga_writeln("prof: out of memory"); return; }
+    }
+    for(uint32_t i=0;i<=ksyms_count;i++){
+        self_hits[i] = 0;
+#ifdef PROF_CALLCHAIN
+        incl_hits[i] = 0;
+#endif
+    }
+    for(uint32_t i=0;i<n;i++){
+        uint32_t slot = sym_slot(samples[i].eip);
+        self_hits[slot]++;
+#ifdef PROF_CALLCHAIN
+        /* count each function at most once per sample */
+        uint32_t seen[PROF_CHAIN_DEPTH + 1]; int ns = 0;
+        seen[ns++] = slot;
+        incl_hits[slot]++;
+        for(int d=0; d<PROF_CHAIN_DEPTH && samples[i].chain[d]; d++){
+            uint32_t c = sym_slot(samples[i].chain[d]), k;
+            for(k=0;k<(uint32_t)ns;k++) if(seen[k] == c) break;
+            if(k < (uint32_t)ns) continue;
+            seen[ns++] = c;
+            incl_hits[c]++;
+        }
+#endif
+    }
+
+    char b[16];
+    shell_utoa32(n, b);
+    vga_write("samples="); vga_write(b);
+    shell_utoa32(dropped, b);
+    vga_write(" dropped="); vga_write(b);
+    vga_writeln(enabled ? " (running)" : "");
+#ifdef PROF_CALLCHAIN
+    vga_writeln("  self%  incl%  samples  function");
+#else
+    vga_writeln("  self%  samples  function");
+#endif
+
+    /* selection of the top entries; clears each hit after printing */
+    for(int k=0;k<PROF_TOP_N;k++){
+        uint32_t best = 0, best_slot = 0;
+        for(uint32_t i=0;i<=ksyms_count;i++){
+            if(self_hits[i] > best){ best = self_hits[i]; best_slot = i; }
+        }
+        if(best == 0) break;
+        write_padded((best * 100u) / n, 6); vga_write("%");
+#ifdef PROF_CALLCHAIN
+        write_padded((incl_hits[best_slot] * 100u) / n, 6); vga_write("%");
+#endif
+        write_padded(best, 9);
+        vga_write("  ");
+        vga_write(slot_name(best_slot));
+        if(best_slot < ksyms_count){
+            shell_hex8(ksyms_table[best_slot].addr, b);
+            vga_write(" (0x"); vga_write(b); vga_write(")");
+        }
+        vga_writeln("");
+        self_hits[best_slot] = 0;
+    }
+
+    print_task_split(n);
+}
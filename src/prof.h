@@ -0,0 +1,15 @@
+#ifndef PROF_H
+#define PROF_H
+#include <stdint.h>
+
+/* Sampling profiler driven by the timer interrupt.
+   Build with `make PROF_FP=1` to also record frame-pointer call chains. */
+
+void prof_start(void);
+void prof_stop(void);
+void prof_top(void);
+
+/* called from the timer ISR with the interrupted EIP/EBP */
+void prof_sample(uint32_t eip, uint32_t ebp);
+
+#endif
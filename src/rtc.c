@@ -1,37 +1,59 @@
 #include "rtc.h"
+#include "io.h"
 #include <stdint.h>
 
-static inline void outb(uint16_t p, uint8_t v){
-    __asm__ volatile("outb %0,%1"::"a"(v),"Nd"(p));
-}
-static inline uint8_t inb(uint16_t p){
-    uint8_t r;
-    __asm__ volatile("inb %1,%0":"=a"(r):"Nd"(p));
-    return r;
-}
+#define REG_A       0x0A
+#define REG_B       0x0B
+#define REG_C       0x0C
+#define A_UIP       0x80        /* update in progress: time registers unstable */
+#define B_UIE       0x10
+#define UIP_SPIN    10000       /* an update takes < 2 ms */
+#define READ_TRIES  4
+
+enum { R_SEC, R_MIN, R_HOUR, R_DAY, R_MONTH, R_YEAR, R_N };
+static const uint8_t time_regs[R_N] = { 0x00, 0x02, 0x04, 0x07, 0x08, 0x09 };
 
+/* The index/data pair is shared with the IRQ8 handler (rtc_ack), so the
+   index write and the data access must not be split by an interrupt. */
 static uint8_t cmos_read(uint8_t reg){
+    uint32_t f = irq_save();
     outb(0x70, reg);
-    return inb(0x71);
+    uint8_t v = inb(0x71);
+    irq_restore(f);
+    return v;
 }
 
 static uint8_t bcd_to_bin(uint8_t b){
     return (b & 0x0F) + ((b >> 4) * 10);
 }
 
+static void read_raw(uint8_t r[R_N]){
+    for(uint32_t i=0; i<UIP_SPIN && (cmos_read(REG_A) & A_UIP); i++) { }
+    for(int i=0;i<R_N;i++) r[i] = cmos_read(time_regs[i]);
+}
+
 void rtc_read(struct rtc_time* t){
     if(!t) return;
 
-    uint8_t sec = cmos_read(0x00);
-    uint8_t min = cmos_read(0x02);
-    uint8_t hour = cmos_read(0x04);
-    uint8_t day = cmos_read(0x07);
-    uint8_t month = cmos_read(0x08);
-    uint8_t year = cmos_read(0x09);
-    uint8_t regB = cmos_read(0x0B);
+    /* an update can still start between the UIP check and the last
+       register; a second pass that matches the first proves it did not */
+    uint8_t r[R_N], again[R_N];
+    read_raw(r);
+    for(int tries=0; tries<READ_TRIES; tries++){
+        read_raw(again);
+        int same = 1;
+        for(int i=0;i<R_N;i++){ if(again[i] != r[i]) same = 0; r[i] = again[i]; }
+        if(same) break;
+    }
+
+    uint8_t sec = r[R_SEC], min = r[R_MIN], hour = r[R_HOUR];
+    uint8_t day = r[R_DAY], month = r[R_MONTH], year = r[R_YEAR];
+    uint8_t regB = cmos_read(REG_B);
 
     int bcd = !(regB & 0x04);   // if bit 2 == 0, values are BCD
     int hour24 = regB & 0x02;   // if bit 1 == 1, 24-hour mode
+    int pm = hour & 0x80;       // 12-hour mode: PM flag sits on top of the BCD digits
+    hour &= 0x7F;
 
     if(bcd){
         sec = bcd_to_bin(sec);
@@ -43,8 +65,6 @@ void rtc_read(struct rtc_time* t){
     }
 
     if(!hour24){
-        int pm = hour & 0x80;
-        hour &= 0x7F;
         if(pm && hour < 12) hour += 12;
         else if(!pm && hour == 12) hour = 0;
     }
@@ -56,3 +76,48 @@ void rtc_read(struct rtc_time* t){
     t->month = month;
     t->year = (year < 70) ? (2000u + year) : (1900u + year);
 }
+
+void rtc_uie_set(int on){
+    uint32_t f = irq_save();
+    outb(0x70, REG_B);
+    uint8_t b = inb(0x71);
+    b = on ? (b | B_UIE) : (b & (uint8_t)~B_UIE);
+    outb(0x70, REG_B);
+    outb(0x71, b);
+    irq_restore(f);
+    rtc_ack();
+}
+
+uint8_t rtc_ack(void){
+    return cmos_read(REG_C);
+}
+
+/* days since 1970-01-01 of a proleptic Gregorian date (Howard Hinnant's
+   days_from_civil, restricted to unsigned years >= 1970) */
+static uint32_t days_from_civil(uint32_t y, uint32_t m, uint32_t d){
+    y -= m <= 2;
+    uint32_t era = y / 400, yoe = y - era * 400;
+    uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+uint32_t rtc_to_unix(const struct rtc_time* t){
+    return days_from_civil(t->year, t->month, t->day) * 86400u
+         + t->hour * 3600u + t->min * 60u + t->sec;
+}
+
+void rtc_from_unix(uint32_t secs, struct rtc_time* t){
+    uint32_t days = secs / 86400u, rem = secs % 86400u;
+    t->hour = (uint8_t)(rem / 3600u);
+    t->min  = (uint8_t)(rem / 60u % 60u);
+    t->sec  = (uint8_t)(rem % 60u);
+
+    uint32_t z = days + 719468, era = z / 146097, doe = z - era * 146097;
+    uint32_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+    uint32_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+    uint32_t mp = (5*doy + 2) / 153;
+    t->day   = (uint8_t)(doy - (153*mp + 2)/5 + 1);
+    t->month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    t->year  = (uint16_t)(yoe + era * 400 + (t->month <= 2));
+}
@@ -11,6 +11,19 @@ struct rtc_time {
     uint16_t year;
 };
 
+/* Waits out an update in progress and reads until two passes agree, so
+   the result is never torn across a seconds rollover. Slow (tens of port
+   accesses); use time_now() (clock.h) for timestamps. */
 void rtc_read(struct rtc_time* t);
 
+/* update-ended interrupt (IRQ8), once per second right after the RTC
+   advanced; the next update is ~1 s away, so rtc_read is safe then */
+#define RTC_UF  0x10            /* register C: update-ended flag */
+void    rtc_uie_set(int on);
+uint8_t rtc_ack(void);          /* read register C; IRQ8 stays low until it is read */
+
+/* seconds since 1970-01-01 (years 1970-2105), and back */
+uint32_t rtc_to_unix(const struct rtc_time* t);
+void     rtc_from_unix(uint32_t secs, struct rtc_time* t);
+
 #endif
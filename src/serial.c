@@ -0,0 +1,47 @@
+#include "serial.h"
+#include "io.h"
+#include <stdint.h>
+
+#define COM1        0x3F8
+#define REG_DATA    0
+#define REG_IER     1
+#define REG_FCR     2
+#define REG_LCR     3
+#define REG_MCR     4
+#define REG_LSR     5
+#define LSR_THRE    0x20        /* transmit holding register empty */
+#define SPIN_MAX    100000      /* give up on a wedged UART */
+
+static int present = 0;
+
+void serial_init(void){
+    outb(COM1 + REG_IER, 0x00);         /* polled: no interrupts */
+    outb(COM1 + REG_LCR, 0x80);         /* DLAB on */
+    outb(COM1 + REG_DATA, 0x01);        /* divisor 1 = 115200 baud */
+    outb(COM1 + REG_IER, 0x00);
+    outb(COM1 + REG_LCR, 0x03);         /* 8N1, DLAB off */
+    outb(COM1 + REG_FCR, 0xC7);         /* FIFOs on, cleared, 14-byte threshold */
+
+    /* loopback: a missing UART reads back 0xFF */
+    outb(COM1 + REG_MCR, 0x1E);
+    outb(COM1 + REG_DATA, 0xAE);
+    present = inb(COM1 + REG_DATA) == 0xAE;
+    outb(COM1 + REG_MCR, 0x0F);         /* normal operation, DTR/RTS/OUT1/OUT2 */
+}
+
+int serial_present(void){ return present; }
+
+static void put_raw(char c){
+    for(uint32_t i=0; i<SPIN_MAX && !(inb(COM1 + REG_LSR) & LSR_THRE); i++) { }
+    outb(COM1 + REG_DATA, (uint8_t)c);
+}
+
+void serial_putc(char c){
+    if(!present) return;
+    if(c == '\n') put_raw('\r');
+    put_raw(c);
+}
+
+void serial_write(const char *s){
+    while(*s) serial_putc(*s++);
+}
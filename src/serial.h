@@ -0,0 +1,11 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+/* COM1 (0x3F8), 115200 8N1, polled. Output is dropped if no UART answers
+   the loopback test in serial_init. */
+void serial_init(void);
+int  serial_present(void);
+void serial_putc(char c);           /* "\n" goes out as "\r\n" */
+void serial_write(const char *s);
+
+#endif
@@ -0,0 +1,70 @@
+#include "shell.h"
+#include <stddef.h>
+#include <stdint.h>
+
+extern void vga_writeln(const char* s);
+extern void vga_write(const char* s);
+
+static char history[HISTORY_MAX][CMD_MAX_LEN];
+static int history_count = 0;   // number of stored commands (<= HISTORY_MAX)
+static int history_start = 0;   // index of the oldest entry
+
+size_t shell_strlen(const char*s){size_t n=0;while(s[n])n++;return n;}
+int shell_streq(const char*a,const char*b){while(*a&&*b&&*a==*b){a++;b++;}return *a==0&&*b==0;}
+int shell_starts(const char*s,const char*p){while(*p){if(*s++!=*p++)return 0;}return 1;}
+void shell_utoa32(uint32_t x,char*b){char t[16];int i=0;if(x==0){b[0]='0';b[1]=0;return;}while(x){t[i++]='0'+(x%10u);x/=10u;}for(int j=0;j<i;j++)b[j]=t[i-1-j];b[i]=0;}
+void shell_hex8(uint32_t x,char*b){static const char h[16]="0123456789ABCDEF";for(int i=7;i>=0;i--){b[7-i]=h[(x>>(i*4))&0xF];}b[8]=0;}
+
+const char* shell_parse_uint(const char* p, uint32_t* out){
+    while(*p == ' ') p++;
+    if(*p < '0' || *p > '9') return 0;
+    uint32_t x = 0;
+    while(*p >= '0' && *p <= '9'){ x = x * 10 + (uint32_t)(*p - '0'); p++; }
+    *out = x;
+    return p;
+}
+
+void history_add(const char* cmd){
+    size_t len = shell_strlen(cmd);
+    if(len == 0) return; // don't store empty lines
+
+    if(len >= CMD_MAX_LEN) len = CMD_MAX_LEN-1;
+
+    int idx;
+    if(history_count < HISTORY_MAX){
+        idx = (history_start + history_count) % HISTORY_MAX;
+        history_count++;
+    } else {
+        // overwrite oldest
+        idx = history_start;
+        history_start = (history_start + 1) % HISTORY_MAX;
+    }
+
+    for(size_t i=0;i<len;i++) history[idx][i] = cmd[i];
+    history[idx][len] = 0;
+}
+
+int history_len(void){ return history_count; }
+
+const char* history_get(int i){
+    if(i < 0 || i >= history_count) return 0;
+    return history[(history_start + i) % HISTORY_MAX];
+}
+
+const char* history_last(void){
+    return history_get(history_count - 1);
+}
+
+void history_print(void){
+    if(history_count == 0){
+        vga_writeln("no history");
+        return;
+    }
+    char num[16];
+    for(int i=0;i<history_count;i++){
+        shell_utoa32((uint32_t)(i+1), num);
+        vga_write(num);
+        vga_write(": ");
+        vga_writeln(history_get(i));
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef SHELL_H
+#define SHELL_H
+#include <stddef.h>
+#include <stdint.h>
+
+/* Shell helpers split out of kernel.c: command history ring and the
+   small string/argument parsers used by run_cmd. Portable C only, so
+   they also build in the hosted test target. */
+
+#define HISTORY_MAX 10
+#define CMD_MAX_LEN 128
+
+size_t shell_strlen(const char* s);
+int    shell_streq(const char* a, const char* b);
+int    shell_starts(const char* s, const char* prefix);
+void   shell_utoa32(uint32_t x, char* b);      /* decimal; b holds 11 bytes */
+void   shell_hex8(uint32_t x, char* b);        /* 8 upper-case hex digits; b holds 9 bytes */
+
+/* skip spaces, parse a decimal number; returns the position after it,
+   or 0 if there is no number (then *out is untouched) */
+const char* shell_parse_uint(const char* p, uint32_t* out);
+
+void        history_add(const char* cmd);
+void        history_print(void);
+int         history_len(void);
+const char* history_get(int i);      /* 0 = oldest */
+const char* history_last(void);      /* 0 if empty */
+
+#endif
@@ -0,0 +1,198 @@
+#include "syscall.h"
+#include "irq.h"
+#include "gdt.h"
+#include "task.h"
+#include "tsc.h"
+#include "math64.h"
+#include "paging.h"
+#include "loader.h"
+#include "shell.h"
+#include <stdint.h>
+
+extern void vga_writeln(const char* s);
+extern void vga_write(const char* s);
+extern void vga_putc(char c);
+
+#define MSR_SYSENTER_CS   0x174
+#define MSR_SYSENTER_ESP  0x175
+#define MSR_SYSENTER_EIP  0x176
+
+#define USER_LIMIT        0x02000000u   /* end of the identity map */
+#define WRITE_MAX         1024u
+
+int syscall_sysenter_ok USER_DATA = 0;    /* read by ring-3 usys_call */
+
+static inline void wrmsr(uint32_t msr, uint32_t lo, uint32_t hi){
+    __asm__ volatile("wrmsr" :: "c"(msr), "a"(lo), "d"(hi));
+}
+
+static inline void cpuid(uint32_t leaf,uint32_t* a,uint32_t* b,uint32_t* c,uint32_t* d){
+    __asm__ volatile("cpuid":"=a"(*a),"=b"(*b),"=c"(*c),"=d"(*d):"a"(leaf),"c"(0));
+}
+
+uint32_t syscall_dispatch(uint32_t num, uint32_t a1, uint32_t a2, uint32_t a3){
+    (void)a3;
+    switch(num){
+    case SYS_WRITE: {
+        const char *p = (const char*)(uintptr_t)a1;
+        if(a2 > WRITE_MAX) return (uint32_t)-1;
+        /* ring-3 pages of the identity map, or a loaded program's own
+           range (possibly not faulted in yet); bound a1 first so the
+           length test cannot wrap */
+        int low  = a1 < USER_LIMIT && a2 <= USER_LIMIT - a1 && paging_user_range(a1, a2);
+        int prog = a1 >= PAGING_USER_BASE && a1 < PAGING_USER_END && a2 <= PAGING_USER_END - a1;
+        if(!low && !prog) return (uint32_t)-1;
+        for(uint32_t i=0;i<a2;i++) vga_putc(p[i]);
+        return a2;
+    }
+    case SYS_YIELD:
+        task_yield();
+        return 0;
+    case SYS_SLEEP:
+        task_sleep(a1);
+        return 0;
+    case SYS_EXIT:
+        prog_exit(task_current_id());
+        task_exit();
+    case SYS_GETPID:
+        return (uint32_t)task_current_id();
+    default:
+        return (uint32_t)-1;
+    }
+}
+
+#ifndef HOSTED
+/* int 0x80: trap gate, so interrupts stay enabled during the call */
+__attribute__((naked)) void syscall_int80_stub(void){
+    __asm__ volatile(
+        "pusha\n"
+        "pushl %edi\n"
+        "pushl %esi\n"
+        "pushl %ebx\n"
+        "pushl %eax\n"
+        "call syscall_dispatch\n"
+        "addl $16, %esp\n"
+        "movl %eax, 28(%esp)\n"     /* return value into the saved EAX */
+        "popa\n"
+        "iret\n"
+    );
+}
+
+/* SYSENTER lands here on the task's kernel stack (IA32_SYSENTER_ESP)
+   with interrupts off. ECX/EDX carry the user ESP/EIP for SYSEXIT. */
+__attribute__((naked)) void syscall_sysenter_entry(void){
+    __asm__ volatile(
+        "pushl %ecx\n"
+        "pushl %edx\n"
+        "pushl %ebp\n"
+        "pushl %edi\n"
+        "pushl %esi\n"
+        "pushl %ebx\n"
+        "pushl %edi\n"
+        "pushl %esi\n"
+        "pushl %ebx\n"
+        "pushl %eax\n"
+        "sti\n"
+        "call syscall_dispatch\n"
+        "addl $16, %esp\n"
+        "popl %ebx\n"
+        "popl %esi\n"
+        "popl %edi\n"
+        "popl %ebp\n"
+        "popl %edx\n"
+        "popl %ecx\n"
+        "sysexit\n"
+    );
+}
+
+void syscall_init(void){
+    irq_set_gate(SYSCALL_VECTOR, syscall_int80_stub, IDT_GATE_USER);
+
+    /* CPUID.1:EDX.SEP; early P6 steppings report it without supporting it */
+    uint32_t a,b,c,d;
+    cpuid(1,&a,&b,&c,&d);
+    uint32_t family = (a >> 8) & 0xF, model = (a >> 4) & 0xF, stepping = a & 0xF;
+    if(!(d & (1u<<11))) return;
+    if(family == 6 && model < 3 && stepping < 3) return;
+
+    wrmsr(MSR_SYSENTER_CS, KERNEL_CS, 0);
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)syscall_sysenter_entry, 0);
+    wrmsr(MSR_SYSENTER_ESP, 0, 0);
+    syscall_sysenter_ok = 1;
+}
+
+int syscall_has_sysenter(void){ return syscall_sysenter_ok; }
+
+void syscall_set_kernel_stack(uint32_t esp0){
+    static uint32_t cur = 0;
+    if(!syscall_sysenter_ok || esp0 == cur) return;
+    wrmsr(MSR_SYSENTER_ESP, esp0, 0);
+    cur = esp0;
+}
+
+/* ---- ring-3 demo and round-trip benchmark ---- */
+
+#define BENCH_ITERS 10000u
+
+/* The ring-3 halves below live in the .user section (paging.h): they may
+   only touch their stack, USER_DATA/USER_RODATA and make syscalls. */
+static volatile int bench_done USER_DATA = 0;
+static volatile uint64_t bench_int80 USER_DATA = 0, bench_sysenter USER_DATA = 0;
+
+USER_TEXT static uint32_t ustrlen(const char *s){ uint32_t n=0; while(s[n]) n++; return n; }
+
+USER_TEXT static void uputs(const char *s){ usys_call(SYS_WRITE, (uint32_t)s, ustrlen(s), 0); }
+
+USER_TEXT static void bench_user_task(void){
+    uint64_t t0 = rdtsc();
+    for(uint32_t i=0;i<BENCH_ITERS;i++) usys_int80(SYS_GETPID, 0, 0, 0);
+    bench_int80 = rdtsc() - t0;
+
+    if(syscall_sysenter_ok){
+        t0 = rdtsc();
+        for(uint32_t i=0;i<BENCH_ITERS;i++) usys_sysenter(SYS_GETPID, 0, 0, 0);
+        bench_sysenter = rdtsc() - t0;
+    }
+    bench_done = 1;
+    usys_call(SYS_EXIT, 0, 0, 0);
+}
+
+void syscall_bench(void){
+    bench_done = 0;
+    bench_sysenter = 0;
+    if(task_create_user(bench_user_task) < 0) return;
+    while(!bench_done) task_yield();
+
+    char t[16];
+    vga_write("int 0x80: ");
+    shell_utoa32((uint32_t)div64_32(bench_int80, BENCH_ITERS, 0), t);
+    vga_write(t); vga_writeln(" cycles/call");
+    vga_write("sysenter: ");
+    if(!syscall_sysenter_ok){ vga_writeln("not supported"); return; }
+    shell_utoa32((uint32_t)div64_32(bench_sysenter, BENCH_ITERS, 0), t);
+    vga_write(t); vga_writeln(" cycles/call");
+}
+
+static const char demo_pid[]  USER_RODATA = "[user] pid=";
+static const char demo_tick[] USER_RODATA = " tick\n";
+static const char demo_exit[] USER_RODATA = "[user] exiting\n";
+
+USER_TEXT static void demo_user_task(void){
+    char d[2];
+    uint32_t pid = usys_call(SYS_GETPID, 0, 0, 0);
+    d[0] = (char)('0' + (pid / 10) % 10);
+    d[1] = (char)('0' + pid % 10);
+    for(int i=0;i<5;i++){
+        uputs(demo_pid);
+        usys_call(SYS_WRITE, (uint32_t)d, 2, 0);
+        uputs(demo_tick);
+        usys_call(SYS_SLEEP, 50, 0, 0);
+    }
+    uputs(demo_exit);
+    usys_call(SYS_EXIT, 0, 0, 0);
+}
+
+void syscall_user_demo(void){
+    task_create_user(demo_user_task);
+}
+#endif
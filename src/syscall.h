@@ -0,0 +1,53 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+#include <stdint.h>
+
+/* System calls: eax = number, ebx/esi/edi = arguments, result in eax.
+   Entered with SYSENTER when the CPU has it, else with `int 0x80`. */
+
+#define SYS_WRITE   1   /* (const char* buf, uint32_t len) -> bytes written */
+#define SYS_YIELD   2
+#define SYS_SLEEP   3   /* (uint32_t ticks) */
+#define SYS_EXIT    4
+#define SYS_GETPID  5
+
+#define SYSCALL_VECTOR 0x80
+
+void syscall_init(void);
+int  syscall_has_sysenter(void);
+
+/* IA32_SYSENTER_ESP for the task being switched in */
+void syscall_set_kernel_stack(uint32_t esp0);
+
+uint32_t syscall_dispatch(uint32_t num, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/* ring-3 side; always inlined, since ring-3 code in the kernel image
+   cannot call into kernel text */
+static inline __attribute__((always_inline)) uint32_t usys_int80(uint32_t num, uint32_t a1, uint32_t a2, uint32_t a3){
+    uint32_t ret;
+    __asm__ volatile("int $0x80" : "=a"(ret) : "a"(num), "b"(a1), "S"(a2), "D"(a3) : "memory");
+    return ret;
+}
+
+/* SYSEXIT returns to EDX with ESP = ECX, so pass both in */
+static inline __attribute__((always_inline)) uint32_t usys_sysenter(uint32_t num, uint32_t a1, uint32_t a2, uint32_t a3){
+    uint32_t ret;
+    __asm__ volatile(
+        "movl %%esp, %%ecx\n"
+        "movl $1f, %%edx\n"
+        "sysenter\n"
+        "1:\n"
+        : "=a"(ret) : "a"(num), "b"(a1), "S"(a2), "D"(a3) : "ecx", "edx", "memory");
+    return ret;
+}
+
+extern int syscall_sysenter_ok;
+
+static inline __attribute__((always_inline)) uint32_t usys_call(uint32_t num, uint32_t a1, uint32_t a2, uint32_t a3){
+    return syscall_sysenter_ok ? usys_sysenter(num, a1, a2, a3) : usys_int80(num, a1, a2, a3);
+}
+
+void syscall_bench(void);
+void syscall_user_demo(void);
+
+#endif
@@ -1,25 +1,15 @@
 #include "task.h"
 #include "kalloc.h"
+#include "gdt.h"
+#include "irq.h"
+#include "io.h"
+#include "syscall.h"
+#include "paging.h"
+#include "klog.h"
 #include <stdint.h>
 
 /* extern vga helpers (defined in vga.c) */
 extern void vga_writeln(const char* s);
-extern void vga_write(const char* s);
-
-/* Local helpers */
-static void utoa32_local(uint32_t x, char* b){
-    char t[16]; int i=0;
-    if(x==0){ b[0]='0'; b[1]=0; return; }
-    while(x){ t[i++] = '0' + (x % 10u); x/=10u; }
-    for(int j=0;j<i;j++) b[j]=t[i-1-j];
-    b[i]=0;
-}
-
-static void hex8_local(uint32_t x, char* b){
-    static const char h[] = "0123456789ABCDEF";
-    for(int i=0;i<8;i++) b[i] = h[(x >> ((7-i)*4)) & 0xF];
-    b[8] = 0;
-}
 
 /* Scheduler state */
 static task_t *task_head = 0;
@@ -28,6 +18,7 @@ static int next_id = 1;
 static uint32_t sched_total_ticks = 0;
 static volatile uint32_t sched_ticks_hint = 0;
 static volatile int need_resched = 0;
+static uint32_t ctx_switches = 0;
 
 void task_init(void){
     task_head = 0;
@@ -36,56 +27,101 @@ void task_init(void){
     sched_total_ticks = 0;
 }
 
+const char* task_state_name(int st){
+    switch(st){
+        case TASK_READY:    return "ready";
+        case TASK_SLEEPING: return "sleeping";
+        case TASK_BLOCKED:  return "blocked";
+        default:            return "dead";
+    }
+}
+
 void task_list(void){
     task_t *t = task_head;
     if(!t){
         vga_writeln("No tasks");
         return;
     }
-    char n[16];
     do {
-        utoa32_local((uint32_t)t->id, n);
-        vga_write("task ");
-        vga_writeln(n);
+        kprintf("task %d  %s%s%s\n", t->id, t->name, t->user ? "  user  " : "  kernel  ",
+                task_state_name(t->state));
         t = t->next;
     } while(t != task_head);
 }
 
-/* Create task stack in the format expected by task_yield / initial_enter:
-   top-of-stack:
-      [dummy regs for popa] (8 * 4 bytes)
-      [return address = entry]
-   Then initial_enter / yield will:
-      mov esp, stack;
-      popa;
-      ret;   --> jumps into entry()
-*/
-void task_create(void (*entry)(void)){
+#define EFLAGS_IF       0x202
+#define EFLAGS_NOIF     0x002
+
+/* allocate a canary-filled kernel stack plus a TCB and return the stack top.
+   The stack comes first so the TCB sits above its top, and it starts
+   TASK_STACK_GAP bytes into its block: the heap never frees, so whatever
+   lies below is the previous allocation (usually the previous task's TCB),
+   and an overrun has to get through the guard words and the gap before
+   it reaches it. */
+static task_t* task_alloc(const char *name, uint32_t stack_size, uint32_t **sp_out){
+    if(stack_size == 0) stack_size = TASK_STACK_DEFAULT;
+    if(stack_size < TASK_STACK_MIN) stack_size = TASK_STACK_MIN;
+    stack_size = (stack_size + 15u) & ~15u;
+
+    uint32_t *block = (uint32_t*)kmalloc(TASK_STACK_GAP + stack_size);
+    if(!block){
+        vga_writeln("task_create: stack alloc failed");
+        return 0;
+    }
     task_t *t = (task_t*)kmalloc(sizeof(task_t));
     if(!t){
         vga_writeln("task_create: alloc failed for task_t");
-        return;
-    }
-    uint32_t *stack = (uint32_t*)kmalloc(4096);
-    if(!stack){
-        vga_writeln("task_create: stack alloc failed");
-        return;
+        return 0;
     }
+    for(uint32_t i=0;i<(TASK_STACK_GAP + stack_size)/4;i++) block[i] = TASK_STACK_CANARY;
+    uint32_t *stack = block + TASK_STACK_GAP/4;
+    uint32_t *sp = stack + (stack_size/4);
+
+    if(!name) name = "task";
+    int k = 0;
+    for(; name[k] && k < (int)sizeof(t->name)-1; k++) t->name[k] = name[k];
+    t->name[k] = 0;
+
+    t->id         = next_id++;
+    t->run_ticks  = 0;
+    t->state      = TASK_READY;
+    t->wake_tick  = 0;
+    t->kstack_top = (uint32_t)(uintptr_t)sp;
+    t->user       = 0;
+    t->stack_base = stack;
+    t->stack_size = stack_size;
+    t->page_dir   = 0;
+    *sp_out = sp;
+    return t;
+}
 
-    uint32_t *sp = stack + (4096/4);   /* 4096 bytes / 4 = 1024 uint32_t */
+/* lowest stack word that no longer holds the fill pattern */
+uint32_t task_stack_peak(const task_t *t){
+    uint32_t words = t->stack_size / 4, i = 0;
+    while(i < words && t->stack_base[i] == TASK_STACK_CANARY) i++;
+    return (words - i) * 4;
+}
 
-    /* push return address = entry (will be used by 'ret') */
-    *(--sp) = (uint32_t)entry;
+/* the saved ESP is below the stack, or the guard words or gap were written */
+static int task_stack_overflowed(const task_t *t){
+    if(t->stack < t->stack_base + TASK_STACK_GUARD) return 1;
+    for(int i = -(int)(TASK_STACK_GAP/4); i<TASK_STACK_GUARD; i++)
+        if(t->stack_base[i] != TASK_STACK_CANARY) return 1;
+    return 0;
+}
 
+/* push the frame task_yield / task_initial_enter pop: 8 regs, EFLAGS, ret */
+static void task_push_switch_frame(task_t *t, uint32_t *sp, uint32_t ret, uint32_t eflags){
+    *(--sp) = ret;
+    *(--sp) = eflags;
     /* push 8 dummy registers (EDI,ESI,EBP,ESP_s,EBX,EDX,ECX,EAX) */
     for(int i=0;i<8;i++){
         *(--sp) = 0;
     }
+    t->stack = sp;
+}
 
-    t->stack     = sp;
-    t->id        = next_id++;
-    t->run_ticks = 0;
-
+static void task_link(task_t *t){
     if(!task_head){
         task_head = t;
         t->next = t;   /* single node circle */
@@ -95,18 +131,101 @@ void task_create(void (*entry)(void)){
         tail->next = t;
         t->next = task_head;
     }
+    timer_nohz_kick();
+
+    klog(KLOG_INFO, "Created %stask %d", t->user ? "user " : "", t->id);
+}
+
+/* Create task stack in the format expected by task_yield / initial_enter:
+   top-of-stack:
+      [dummy regs for popa] (8 * 4 bytes)
+      [EFLAGS for popf]
+      [return address = entry]
+   Then initial_enter / yield will:
+      mov esp, stack;
+      popa; popf;
+      ret;   --> jumps into entry()
+*/
+int task_create(void (*entry)(void)){
+    uint32_t *sp;
+    task_t *t = task_alloc(0, 0, &sp);
+    if(!t) return -1;
+    task_push_switch_frame(t, sp, (uint32_t)(uintptr_t)entry, EFLAGS_IF);
+    task_link(t);
+    return t->id;
+}
+
+/* Same frame, with the entry's own call frame below it: task_exit as the
+   return address, then the argument. */
+int task_create_ex(const struct task_attrs *a){
+    uint32_t *sp;
+    task_t *t = task_alloc(a->name, a->stack_size, &sp);
+    if(!t) return -1;
+    *(--sp) = (uint32_t)(uintptr_t)a->arg;
+    *(--sp) = (uint32_t)(uintptr_t)task_exit;
+    task_push_switch_frame(t, sp, (uint32_t)(uintptr_t)a->entry, EFLAGS_IF);
+    task_link(t);
+    return t->id;
+}
+
+#ifdef HOSTED
+/* host test builds (make test) never run tasks; only the frames are built */
+static void task_user_trampoline(void){ }
+#else
+/* First instructions of a ring-3 task: load user data segments and iret
+   into the user frame that task_create_user left above the return slot. */
+__attribute__((naked))
+static void task_user_trampoline(void){
+    __asm__ volatile(
+        "movw $0x23, %ax\n"
+        "movw %ax, %ds\n"
+        "movw %ax, %es\n"
+        "movw %ax, %fs\n"
+        "movw %ax, %gs\n"
+        "iret\n"
+    );
+}
+#endif
+
+int task_create_user_at(const char *name, uint32_t eip, uint32_t esp, uint32_t *page_dir){
+    uint32_t *sp;
+    task_t *t = task_alloc(name ? name : "user", 0, &sp);
+    if(!t) return -1;
+    t->user = 1;
+    t->page_dir = page_dir;
+
+    /* iret frame into ring 3 */
+    *(--sp) = USER_DS;
+    *(--sp) = esp;
+    *(--sp) = EFLAGS_IF;
+    *(--sp) = USER_CS;
+    *(--sp) = eip;
+    /* the trampoline runs with interrupts off until its iret */
+    task_push_switch_frame(t, sp, (uint32_t)(uintptr_t)task_user_trampoline, EFLAGS_NOIF);
+    task_link(t);
+    return t->id;
+}
 
-    char nbuf[16]; utoa32_local((uint32_t)t->id, nbuf);
-    vga_write("Created task ");
-    vga_writeln(nbuf);
+int task_create_user(void (*entry)(void)){
+    /* whole pages, so handing them to ring 3 exposes nothing else */
+    uint32_t *ustack = (uint32_t*)kmalloc_aligned(TASK_STACK_DEFAULT, 4096);
+    if(!ustack || paging_map_identity((uint32_t)(uintptr_t)ustack, TASK_STACK_DEFAULT,
+                                      PAGE_USER | PAGE_RW)){
+        vga_writeln("task_create_user: user stack alloc failed");
+        return -1;
+    }
+    return task_create_user_at("user", (uint32_t)(uintptr_t)entry,
+                               (uint32_t)(uintptr_t)(ustack + TASK_STACK_DEFAULT/4), 0);
 }
 
-/* First-time enter: restore dummy regs, then ret -> entry() */
+#ifndef HOSTED
+/* First-time enter: restore dummy regs and EFLAGS, then ret -> entry() */
 __attribute__((noreturn))
 static void task_initial_enter(uint32_t *new_stack){
     __asm__ volatile(
         "mov %0, %%esp\n"
         "popa\n"
+        "popfl\n"
         "ret\n"
         :: "r"(new_stack)
     );
@@ -123,12 +242,70 @@ void task_switch_first(void){
     vga_writeln("switching to first task...");
     task_initial_enter(current_task->stack);
 }
+#endif
+
+#ifdef HOSTED
+void task_idle_wait(void);      /* tests/host_shim.c advances the fake clock */
+#else
+/* nothing runnable: wait for the next interrupt (with nohz, the timer is
+   first pointed at the earliest sleep expiry) */
+static void task_idle_wait(void){
+    timer_nohz_idle();
+    __asm__ volatile("sti; hlt; cli" ::: "memory");
+}
+#endif
+
+static void task_unlink(task_t *t);
+
+static int task_runnable(task_t *t, uint32_t now){
+    if(t->state == TASK_SLEEPING && (int32_t)(now - t->wake_tick) >= 0)
+        t->state = TASK_READY;
+    return t->state == TASK_READY;
+}
+
+/* Called from task_yield on the outgoing task's stack: pick the next
+   runnable task after current_task, make it current and return it.
+   When nothing is runnable, wait for the timer with hlt. */
+task_t* task_pick_next(void){
+    task_t *prev = current_task;
+    if(prev->state != TASK_DEAD && task_stack_overflowed(prev)){
+        klog(KLOG_ERR, "task %d (%s): kernel stack overflow, killed", prev->id, prev->name);
+        task_unlink(prev);
+    }
+    task_t *start = current_task->next;
+    for(;;){
+        uint32_t now = timer_ticks();
+        task_t *t = start;
+        do {
+            if(task_runnable(t, now)){
+                if(t != prev) ctx_switches++;
+                current_task = t;
+                paging_switch(t->page_dir);
+                if(t->user){
+                    gdt_set_kernel_stack(t->kstack_top);
+                    syscall_set_kernel_stack(t->kstack_top);
+                }
+                return t;
+            }
+            t = t->next;
+        } while(t != start);
+        task_idle_wait();
+    }
+}
 
-/* Cooperative yield: save ESP of current_task, advance to next,
-   restore its ESP, return into that task. */
+#ifdef HOSTED
+/* host test builds: no stacks to switch, just take the scheduling decision */
+void task_yield(void){
+    if(current_task) task_pick_next();
+}
+#else
+/* Yield: save registers and EFLAGS on the current stack, store ESP into
+   current_task->stack, let task_pick_next choose the next task, restore
+   its ESP and return into it. */
 __attribute__((naked))
 void task_yield(void){
     __asm__ volatile(
+        "pushfl\n"
         "pusha\n"
         "movl current_task, %eax\n"
         "testl %eax, %eax\n"
@@ -137,43 +314,157 @@ void task_yield(void){
         /* save ESP into current_task->stack (offset 0) */
         "movl %esp, (%eax)\n"
 
-        /* advance to next task: current_task = current_task->next */
-        "movl 4(%eax), %eax\n"        /* eax = current_task->next */
-        "movl %eax, current_task\n"   /* current_task = eax */
+        /* eax = next task; current_task already updated */
+        "call task_pick_next\n"
 
         /* load ESP from new current_task->stack */
         "movl (%eax), %esp\n"
 
-        "popa\n"
-        "ret\n"
-
         "1:\n"
         "popa\n"
+        "popfl\n"
         "ret\n"
     );
 }
+#endif
+
+uint32_t task_sleep(uint32_t ticks){
+    uint32_t wake = timer_ticks() + ticks;
+    if(!current_task) return wake;
+    current_task->wake_tick = wake;
+    current_task->state = TASK_SLEEPING;
+    task_yield();
+    return wake;
+}
+
+void task_block(void){
+    if(!current_task) return;
+    current_task->state = TASK_BLOCKED;
+    task_yield();
+}
+
+void task_wake(int id){
+    task_t *t = task_head;
+    if(!t) return;
+    do {
+        if(t->id == id){
+            if(t->state == TASK_BLOCKED || t->state == TASK_SLEEPING){
+                t->state = TASK_READY;
+                timer_nohz_kick();
+            }
+            return;
+        }
+        t = t->next;
+    } while(t != task_head);
+}
+
+/* Remove t from the ring. Its `next` pointer is left intact so
+   task_pick_next can continue from it if t is the current task.
+   The bump allocator cannot free the stack or TCB. */
+static void task_unlink(task_t *t){
+    t->state = TASK_DEAD;
+    if(t->next == t) return;
+    task_t *prev = t;
+    while(prev->next != t) prev = prev->next;
+    prev->next = t->next;
+    if(task_head == t) task_head = t->next;
+}
+
+#ifdef HOSTED
+void task_exit(void){
+    task_unlink(current_task);
+    task_yield();
+    for(;;) { }
+}
+#else
+void task_exit(void){
+    __asm__ volatile("cli");
+    task_unlink(current_task);
+    task_yield();
+    for(;;) __asm__ volatile("hlt");
+}
+#endif
+
+int task_kill(int id){
+    if(current_task && current_task->id == id) task_exit();
+    uint32_t flags = irq_save();
+    task_t *t = task_head;
+    if(t){
+        do {
+            if(t->id == id){
+                task_unlink(t);
+                irq_restore(flags);
+                return 0;
+            }
+            t = t->next;
+        } while(t != task_head);
+    }
+    irq_restore(flags);
+    return -1;
+}
+
+int task_nohz_state(uint32_t now, uint32_t *until_wake){
+    uint32_t best = 0xFFFFFFFFu;
+    int n = 0;
+    task_t *t = task_head;
+    if(t){
+        do {
+            if(task_runnable(t, now)) n++;
+            else if(t->state == TASK_SLEEPING && t->wake_tick - now < best) best = t->wake_tick - now;
+            t = t->next;
+        } while(t != task_head);
+    }
+    *until_wake = best;
+    return n;
+}
+
+int task_snapshot(struct task_info *out, int max){
+    int n = 0;
+    task_t *t = task_head;
+    if(!t) return 0;
+    do {
+        if(n == max) break;
+        struct task_info *i = &out[n++];
+        i->id = t->id;
+        for(int k=0;k<(int)sizeof(i->name);k++) i->name[k] = t->name[k];
+        i->state      = t->state;
+        i->user       = t->user;
+        i->run_ticks  = t->run_ticks;
+        i->stack_peak = task_stack_peak(t);
+        i->stack_size = t->stack_size;
+        t = t->next;
+    } while(t != task_head);
+    return n;
+}
+
+uint32_t task_switch_count(void){ return ctx_switches; }
 
 int task_current_id(void){
     return current_task ? current_task->id : -1;
 }
 
-/* called from timer ISR every tick */
-void task_on_tick(void){
-    sched_total_ticks++;
+int task_current_is_user(void){
+    return current_task ? current_task->user : 0;
+}
+
+/* called from the timer bottom half with the ticks since the last call
+   (more than one when the tick was stopped, see irq.c) */
+void task_on_tick(uint32_t n){
+    sched_total_ticks += n;
     if(current_task){
-        current_task->run_ticks++;
+        current_task->run_ticks += n;
     }
 
-    /* NEW: every ~10 timer ticks, ask for a reschedule */
-    sched_ticks_hint++;
-    if(sched_ticks_hint >= 10){
+    /* every ~100 ms worth of ticks, ask for a reschedule */
+    sched_ticks_hint += n;
+    if(sched_ticks_hint >= timer_hz() / 10u){
         sched_ticks_hint = 0;
         need_resched = 1;
     }
 }
 
 
-/* print per-task stats: ticks and share% */
+/* print per-task stats: ticks, share% and peak kernel stack use */
 void task_stats_print(void){
     if(!task_head){
         vga_writeln("No tasks");
@@ -192,22 +483,10 @@ void task_stats_print(void){
         return;
     }
 
-    char idbuf[16], tickbuf[16], pctbuf[16];
     t = task_head;
     do {
-        utoa32_local((uint32_t)t->id, idbuf);
-        utoa32_local(t->run_ticks, tickbuf);
-        uint32_t pct = (t->run_ticks * 100u) / total;
-        utoa32_local(pct, pctbuf);
-
-        vga_write("task ");
-        vga_write(idbuf);
-        vga_write("  ticks=");
-        vga_write(tickbuf);
-        vga_write("  share=");
-        vga_write(pctbuf);
-        vga_writeln("%");
-
+        kprintf("task %d  ticks=%u  share=%u%%  stack=%u/%u  %s\n", t->id, t->run_ticks,
+                (t->run_ticks * 100u) / total, task_stack_peak(t), t->stack_size, t->name);
         t = t->next;
     } while(t != task_head);
 }
@@ -3,6 +3,11 @@
 
 #include <stdint.h>
 
+#define TASK_READY     0
+#define TASK_SLEEPING  1
+#define TASK_DEAD      2
+#define TASK_BLOCKED   3   /* waits for task_wake */
+
 /* Task control block
    NOTE: The first two fields (stack, next) are used by inline asm in task_yield.
 */
@@ -11,10 +16,37 @@ typedef struct task {
     struct task *next;      /* next task in circular list */
     int       id;           /* task id */
     uint32_t  run_ticks;    /* how many timer ticks this task has run */
+    int       state;        /* TASK_READY / TASK_SLEEPING / TASK_DEAD */
+    uint32_t  wake_tick;    /* timer_ticks() value to wake at when sleeping */
+    uint32_t  kstack_top;   /* esp0 for ring 3 -> ring 0 entries */
+    int       user;         /* runs in ring 3 */
+    char      name[16];
+    uint32_t *stack_base;   /* lowest word of the kernel stack */
+    uint32_t  stack_size;   /* bytes */
+    uint32_t *page_dir;     /* own address space (loaded programs); 0 = kernel */
 } task_t;
 
+#define TASK_STACK_DEFAULT  4096
+#define TASK_STACK_MIN      1024
+#define TASK_STACK_CANARY   0x5A5A5A5Au   /* fill pattern for high-water marks */
+#define TASK_STACK_GUARD    64            /* bottom words (256 bytes) that must keep the pattern */
+#define TASK_STACK_GAP      256           /* unused, pattern-filled bytes below each stack */
+
+/* task_create_ex attributes; zeroed fields take the defaults */
+struct task_attrs {
+    const char *name;                   /* copied, up to 15 chars; default "task" */
+    uint32_t    stack_size;             /* bytes; default TASK_STACK_DEFAULT */
+    void      (*entry)(void *arg);      /* returning from entry exits the task */
+    void       *arg;
+};
+
 void task_init(void);
-void task_create(void (*entry)(void));
+int  task_create(void (*entry)(void));          /* returns task id or -1 */
+int  task_create_ex(const struct task_attrs *a);/* returns task id or -1 */
+int  task_create_user(void (*entry)(void));     /* ring-3 task; id or -1. `entry` must be USER_TEXT (paging.h) */
+/* ring-3 task entering at `eip` with user stack `esp`, running in the
+   address space `page_dir` (0 = kernel map); id or -1 */
+int  task_create_user_at(const char *name, uint32_t eip, uint32_t esp, uint32_t *page_dir);
 void task_list(void);
 
 /* enter task world for the first time (used only from kernel_main) */
@@ -23,11 +55,46 @@ void task_switch_first(void);
 /* cooperative yield (used from tasks & shell) */
 void task_yield(void);
 
+/* block the current task for `ticks` timer ticks; returns the tick it was
+   set to wake at */
+uint32_t task_sleep(uint32_t ticks);
+
+/* block the current task until task_wake(id); safe to wake from IRQs */
+void task_block(void);
+void task_wake(int id);
+
+/* remove the current task from the scheduler; never returns */
+void task_exit(void) __attribute__((noreturn));
+
+/* remove task `id` from the scheduler (exits if it is the caller);
+   returns -1 if there is no such task */
+int  task_kill(int id);
+
 /* info / stats */
 int  task_current_id(void);
-void task_on_tick(void);
+int  task_current_is_user(void);
+void task_on_tick(uint32_t n);
+/* for the dynamic tick: number of runnable tasks, and ticks until the
+   earliest sleeper wakes (0xFFFFFFFF if none) */
+int  task_nohz_state(uint32_t now, uint32_t *until_wake);
 void task_stats_print(void);
+uint32_t task_stack_peak(const task_t *t);      /* deepest stack use seen, bytes */
+const char* task_state_name(int st);
+
+/* copy of one task's state for monitoring tools (`top`) */
+struct task_info {
+    int      id;
+    char     name[16];
+    int      state;
+    int      user;
+    uint32_t run_ticks;
+    uint32_t stack_peak, stack_size;
+};
+
+/* fill up to `max` entries in ring order; returns the count */
+int  task_snapshot(struct task_info *out, int max);
+/* context switches since boot (task_pick_next choosing a different task) */
+uint32_t task_switch_count(void);
 void scheduler_maybe_yield(void);
 
 #endif
-
@@ -0,0 +1,142 @@
+#include "top.h"
+#include "task.h"
+#include "irq.h"
+#include "kalloc.h"
+#include "math64.h"
+#include <stdint.h>
+
+extern void vga_clear(void);
+extern void vga_write_at(uint32_t x, uint32_t y, const char* s, uint32_t width);
+extern uint32_t vga_cols(void);
+extern uint32_t vga_rows(void);
+extern uint32_t vga_bytes_written(void);
+extern char kbd_trygetch(void);
+
+#define TOP_MAX_TASKS 32
+#define TOP_HEADER    5         /* rows above the task table */
+
+struct top_sample {
+    uint32_t ticks, switches, timer_irqs, irqs, heap, console;
+    int      ntasks;
+    struct task_info tasks[TOP_MAX_TASKS];
+};
+
+static struct top_sample samples[2];
+
+/* fixed-width line assembly; one line is written with one vga_write_at */
+struct line { char b[128]; uint32_t n; };
+
+static void put_str(struct line *l, const char *s, uint32_t width){
+    uint32_t k = 0;
+    while(s[k] && l->n < sizeof(l->b)-1 && (width == 0 || k < width)) l->b[l->n++] = s[k++];
+    while(k < width && l->n < sizeof(l->b)-1){ l->b[l->n++] = ' '; k++; }
+    l->b[l->n] = 0;
+}
+
+static void put_uint(struct line *l, uint32_t x, uint32_t width){
+    char t[16]; int i=0;
+    if(x==0) t[i++] = '0';
+    while(x){ t[i++] = '0' + (x % 10u); x/=10u; }
+    for(uint32_t k=(uint32_t)i;k<width && l->n < sizeof(l->b)-1;k++) l->b[l->n++] = ' ';
+    while(i && l->n < sizeof(l->b)-1) l->b[l->n++] = t[--i];
+    l->b[l->n] = 0;
+}
+
+static void take_sample(struct top_sample *s){
+    s->ticks      = timer_ticks();
+    s->switches   = task_switch_count();
+    s->timer_irqs = timer_irq_count();
+    s->irqs       = irq_count();
+    s->heap       = kalloc_bytes_used();
+    s->console    = vga_bytes_written();
+    s->ntasks     = task_snapshot(s->tasks, TOP_MAX_TASKS);
+}
+
+/* delta over the interval, scaled to one second */
+static uint32_t per_sec(uint32_t d, uint32_t dticks){
+    if(dticks == 0) return 0;
+    return (uint32_t)div64_32((uint64_t)d * timer_hz(), dticks, 0);
+}
+
+static const struct task_info* find_task(const struct top_sample *s, int id){
+    for(int i=0;i<s->ntasks;i++) if(s->tasks[i].id == id) return &s->tasks[i];
+    return 0;
+}
+
+static int draw(const struct top_sample *old, const struct top_sample *now, int last_rows){
+    uint32_t cols = vga_cols(), rows = vga_rows();
+    uint32_t dt = now->ticks - old->ticks;
+    struct line l;
+
+    l.n = 0;
+    put_str(&l, "top - up ", 0); put_uint(&l, now->ticks / timer_hz(), 0);
+    put_str(&l, " s, ", 0); put_uint(&l, (uint32_t)now->ntasks, 0);
+    put_str(&l, " tasks, nohz ", 0); put_str(&l, timer_nohz_enabled() ? "on" : "off", 0);
+    put_str(&l, "   (any key quits)", 0);
+    vga_write_at(0, 0, l.b, cols);
+
+    l.n = 0;
+    put_str(&l, "ctx switches/s ", 0); put_uint(&l, per_sec(now->switches - old->switches, dt), 7);
+    put_str(&l, "   timer irqs/s ", 0); put_uint(&l, per_sec(now->timer_irqs - old->timer_irqs, dt), 6);
+    put_str(&l, "   irqs/s ", 0);       put_uint(&l, per_sec(now->irqs - old->irqs, dt), 6);
+    vga_write_at(0, 1, l.b, cols);
+
+    l.n = 0;
+    uint32_t grow = now->heap >= old->heap ? now->heap - old->heap : 0;
+    put_str(&l, "heap used ", 0);       put_uint(&l, now->heap, 10);
+    put_str(&l, " B  growth ", 0);      put_uint(&l, per_sec(grow, dt), 8);
+    put_str(&l, " B/s   console ", 0);  put_uint(&l, per_sec(now->console - old->console, dt), 7);
+    put_str(&l, " B/s", 0);
+    vga_write_at(0, 2, l.b, cols);
+
+    l.n = 0;
+    put_str(&l, "  ID NAME            TYPE   STATE      CPU%     TICKS STACK", 0);
+    vga_write_at(0, 4, l.b, cols);
+
+    int row = TOP_HEADER;
+    for(int i=0;i<now->ntasks && (uint32_t)row < rows;i++, row++){
+        const struct task_info *t = &now->tasks[i];
+        const struct task_info *p = find_task(old, t->id);
+        uint32_t d = t->run_ticks - (p ? p->run_ticks : 0);
+        uint32_t pct = dt ? (uint32_t)div64_32((uint64_t)d * 100u, dt, 0) : 0;
+        if(pct > 100) pct = 100;
+
+        l.n = 0;
+        put_uint(&l, (uint32_t)t->id, 4); put_str(&l, " ", 0);
+        put_str(&l, t->name, 15);         put_str(&l, " ", 0);
+        put_str(&l, t->user ? "user" : "kernel", 6); put_str(&l, " ", 0);
+        put_str(&l, task_state_name(t->state), 8);
+        put_uint(&l, pct, 6);             put_str(&l, "%", 0);
+        put_uint(&l, t->run_ticks, 10);
+        put_uint(&l, t->stack_peak, 6);   put_str(&l, "/", 0);
+        put_uint(&l, t->stack_size, 0);
+        vga_write_at(0, (uint32_t)row, l.b, cols);
+    }
+    /* blank rows left over from tasks that went away */
+    for(int r=row;r<last_rows;r++) vga_write_at(0, (uint32_t)r, "", cols);
+    return row;
+}
+
+void top_run(void){
+    uint32_t hz = timer_hz();
+    uint32_t poll = hz / 20 ? hz / 20 : 1;      /* ~50 ms keyboard polling */
+    int cur = 0, last_rows = TOP_HEADER;
+
+    vga_clear();
+    vga_write_at(0, 0, "top - collecting...", vga_cols());
+    take_sample(&samples[cur]);
+
+    for(;;){
+        uint32_t start = timer_ticks();
+        while(timer_ticks() - start < hz){
+            if(kbd_trygetch()){
+                vga_clear();
+                return;
+            }
+            task_sleep(poll);
+        }
+        take_sample(&samples[cur ^ 1]);
+        last_rows = draw(&samples[cur], &samples[cur ^ 1], last_rows);
+        cur ^= 1;
+    }
+}
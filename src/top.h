@@ -0,0 +1,9 @@
+#ifndef TOP_H
+#define TOP_H
+
+/* `top`: live view of per-task CPU%, context switch and interrupt rates,
+   heap growth and console throughput, redrawn in place once a second
+   until a key is pressed. */
+void top_run(void);
+
+#endif
@@ -0,0 +1,39 @@
+#include "tsc.h"
+#include "intc.h"
+#include "math64.h"
+#include <stdint.h>
+
+#define CALIBRATE_MS  10u
+
+static uint32_t khz = 0;
+
+/* Count TSC cycles across a 10 ms one-shot on PIT channel 2 (pic.c),
+   which works with interrupts on or off and leaves IRQ0 alone. */
+static uint32_t calibrate(void){
+    pit_ch2_start(CALIBRATE_MS);
+    uint64_t t0 = rdtsc();
+    pit_ch2_wait();
+    uint64_t t1 = rdtsc();
+
+    return (uint32_t)div64_32(t1 - t0, CALIBRATE_MS, 0);
+}
+
+uint32_t tsc_khz(void){
+    if(khz == 0) khz = calibrate();
+    return khz;
+}
+
+uint64_t tsc_to_us(uint64_t cycles){
+    uint32_t k = tsc_khz();
+    if(k < 1000) return 0;
+    return div64_32(cycles, k / 1000u, 0);
+}
+
+uint64_t tsc_to_ns(uint64_t cycles){
+    uint32_t k = tsc_khz();
+    if(k == 0) return 0;
+    /* cycles * 1e6 / khz; split to keep the product in 64 bits */
+    uint32_t rem;
+    uint64_t q = div64_32(cycles, k, &rem);
+    return q * 1000000u + div64_32((uint64_t)rem * 1000000u, k, 0);
+}
@@ -0,0 +1,18 @@
+#ifndef TSC_H
+#define TSC_H
+#include <stdint.h>
+
+static inline uint64_t rdtsc(void){
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* TSC frequency in kHz; calibrated against PIT channel 2 on first use */
+uint32_t tsc_khz(void);
+
+/* cycles -> microseconds / nanoseconds using the calibrated frequency */
+uint64_t tsc_to_us(uint64_t cycles);
+uint64_t tsc_to_ns(uint64_t cycles);
+
+#endif
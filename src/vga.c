@@ -1,50 +1,119 @@
 #include <stddef.h>
 #include <stdint.h>
+#include "fbcon.h"
+#include "serial.h"
+
+#ifdef HOSTED
+extern uint16_t host_vga_mem[80*25];    /* tests/host_shim.c */
+static volatile uint16_t* const VGA=host_vga_mem;
+#else
 static volatile uint16_t* const VGA=(uint16_t*)0xB8000;
-static uint8_t cx=0, cy=0, color=0x0F;
+#endif
+static uint32_t cx=0, cy=0;
+static uint8_t color=0x0F;
+
+/* text grid size: 80x25 on VGA, larger once the framebuffer console is attached */
+static uint32_t cols=80, rows=25;
+static int use_fb = 0;
+static uint32_t bytes_out = 0;      /* characters through the console stream */
+static int mirror = 0;              /* copy the stream to COM1 (batch mode) */
+
+static inline void put_cell(uint32_t x, uint32_t y, uint16_t cell){
+    if(use_fb) fbcon_put_cell(x, y, cell);
+    else VGA[y*80+x] = cell;
+}
+
+static inline uint16_t get_cell(uint32_t x, uint32_t y){
+    return use_fb ? fbcon_get_cell(x, y) : VGA[y*80+x];
+}
+
+static void scroll(){
+    if(cy<rows) return;
+    if(use_fb) fbcon_scroll(color);
+    else {
+        for(int y=1;y<25;y++) for(int x=0;x<80;x++) VGA[(y-1)*80+x]=VGA[y*80+x];
+        for(int x=0;x<80;x++) VGA[24*80+x]=(' ' | ((uint16_t)color<<8));
+    }
+    cy=rows-1;
+}
+
+static int hold = 0;                /* vga_hold depth: flushes wait for vga_release */
+
+static void flush(){
+    if(use_fb && !hold) fbcon_flush();
+}
+
+/* Batch console output: writes between vga_hold and the matching
+   vga_release reach the framebuffer in one flush, so a burst of lines
+   that scrolls the screen costs one full-screen blit instead of one
+   per line. Nests. */
+void vga_hold(){ hold++; }
+
+void vga_release(){
+    if(hold > 0 && --hold == 0) flush();
+}
+
+/* Switch output to the framebuffer console, carrying over what is
+   already on the VGA text screen. */
+void vga_attach_fbcon(){
+    if(!fbcon_active()) return;
+    for(int y=0;y<25;y++) for(int x=0;x<80;x++) fbcon_put_cell(x, y, VGA[y*80+x]);
+    cols = fbcon_cols();
+    rows = fbcon_rows();
+    use_fb = 1;
+    flush();
+}
 
 void vga_set_color(uint8_t c){ color = c; }
+
+static void putc_raw(char c){
+    bytes_out++;
+    if(mirror) serial_putc(c);
+    if(c=='\n'){cx=0; cy++; scroll(); return;}
+    if(c=='\b'){ if(cx>0){cx--; put_cell(cx, cy, ' ' | ((uint16_t)color<<8));} return; }
+    put_cell(cx, cy, (uint16_t)(uint8_t)c | ((uint16_t)color<<8));
+    cx++; if(cx>=cols){cx=0; cy++;} scroll();
+}
+
 void vga_write_color(const char* s, uint8_t c){
     uint8_t old = color;
     vga_set_color(c);
-    while(*s) {
-        if(*s == '\n'){ cx = 0; cy++; if(cy>=25) { /* scroll */ 
-                for(int y=1;y<25;y++) for(int x=0;x<80;x++) VGA[(y-1)*80+x]=VGA[y*80+x];
-                for(int x=0;x<80;x++) VGA[24*80+x]=(' ' | ((uint16_t)color<<8));
-                cy=24;
-            } 
-            s++; continue;
-        }
-        VGA[cy*80+cx]=(uint16_t)*s | ((uint16_t)color<<8);
-        cx++; if(cx>=80){cx=0; cy++; if(cy>=25){ /* scroll */
-                for(int y=1;y<25;y++) for(int x=0;x<80;x++) VGA[(y-1)*80+x]=VGA[y*80+x];
-                for(int x=0;x<80;x++) VGA[24*80+x]=(' ' | ((uint16_t)color<<8));
-                cy=24;
-            }}
-        s++;
-    }
+    while(*s) putc_raw(*s++);
     vga_set_color(old);
-}
-
-static void scroll(){
-    if(cy<25) return;
-    for(int y=1;y<25;y++) for(int x=0;x<80;x++) VGA[(y-1)*80+x]=VGA[y*80+x];
-    for(int x=0;x<80;x++) VGA[24*80+x]=(' ' | ((uint16_t)color<<8));
-    cy=24;
+    flush();
 }
 
 void vga_putc(char c){
-    if(c=='\n'){cx=0; cy++; scroll(); return;}
-    if(c=='\b'){ if(cx>0){cx--; VGA[cy*80+cx]=(' ' | ((uint16_t)color<<8));} return; }
-    VGA[cy*80+cx]=(uint16_t)c | ((uint16_t)color<<8);
-    cx++; if(cx>=80){cx=0; cy++;} scroll();
+    putc_raw(c);
+    flush();
 }
 
 void vga_clear(){
-    for(int y=0;y<25;y++) for(int x=0;x<80;x++) VGA[y*80+x]=(' ' | ((uint16_t)color<<8));
+    if(use_fb) fbcon_clear(color);
+    else for(int y=0;y<25;y++) for(int x=0;x<80;x++) VGA[y*80+x]=(' ' | ((uint16_t)color<<8));
     cx=0; cy=0;
+    flush();
 }
 
-void vga_write(const char* s){ while(*s) vga_putc(*s++); }
-void vga_writeln(const char* s){ vga_write(s); vga_putc('\n'); }
+void vga_write(const char* s){ while(*s) putc_raw(*s++); flush(); }
+void vga_writeln(const char* s){ while(*s) putc_raw(*s++); putc_raw('\n'); flush(); }
 
+uint32_t vga_cols(){ return cols; }
+uint32_t vga_rows(){ return rows; }
+uint32_t vga_bytes_written(){ return bytes_out; }
+void vga_mirror_serial(int on){ mirror = on; }
+int vga_mirrors_serial(){ return mirror; }
+
+/* Write s at (x, y), padded with blanks to `width` cells, without moving
+   the cursor or scrolling. Cells that already hold the same character
+   and colour are skipped, so redrawing an unchanged line touches nothing. */
+void vga_write_at(uint32_t x, uint32_t y, const char* s, uint32_t width){
+    if(y >= rows || x >= cols) return;
+    if(x + width > cols) width = cols - x;
+    for(uint32_t i=0;i<width;i++){
+        char c = *s ? *s++ : ' ';
+        uint16_t cell = (uint16_t)(uint8_t)c | ((uint16_t)color<<8);
+        if(get_cell(x + i, y) != cell) put_cell(x + i, y, cell);
+    }
+    flush();
+}
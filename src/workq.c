@@ -0,0 +1,162 @@
+#include "workq.h"
+#include "task.h"
+#include "tsc.h"
+#include "math64.h"
+#include "io.h"
+#include "shell.h"
+#include <stdint.h>
+
+extern void vga_writeln(const char* s);
+extern void vga_write(const char* s);
+
+#define WQ_RING 64              /* power of two */
+
+#define WQ_MODE_SOFTIRQ 0
+#define WQ_MODE_WORKER  1
+
+struct work_item {
+    work_fn  fn;
+    uint32_t arg;
+    uint64_t tsc;               /* enqueue time */
+};
+
+/* One producer side (interrupt handlers, or tasks with IRQs off) and one
+   consumer (softirq or the worker), so head/tail need no lock. */
+struct workq {
+    const char *name;
+    int mode;
+    struct work_item ring[WQ_RING];
+    volatile uint32_t head;     /* next slot to fill */
+    volatile uint32_t tail;     /* next slot to run */
+
+    uint32_t enqueued, completed, dropped, max_backlog;
+    uint64_t lat_total, lat_max;
+};
+
+static struct workq queues[WQ_NQUEUES] = {
+    [WQ_TIMER] = { .name = "timer", .mode = WQ_MODE_SOFTIRQ },
+    [WQ_KBD]   = { .name = "kbd",   .mode = WQ_MODE_SOFTIRQ },
+    [WQ_DEFER] = { .name = "defer", .mode = WQ_MODE_WORKER },
+    [WQ_RTC]   = { .name = "rtc",   .mode = WQ_MODE_SOFTIRQ },
+};
+
+static volatile int in_softirq = 0;
+static volatile int worker_id = -1;
+
+void workq_init(void){
+    for(int i=0;i<WQ_NQUEUES;i++){
+        struct workq *q = &queues[i];
+        q->head = q->tail = 0;
+        q->enqueued = q->completed = q->dropped = q->max_backlog = 0;
+        q->lat_total = q->lat_max = 0;
+    }
+}
+
+int workq_queue(int qi, work_fn fn, uint32_t arg){
+    if(qi < 0 || qi >= WQ_NQUEUES) return -1;
+    struct workq *q = &queues[qi];
+    uint32_t flags = irq_save();
+
+    uint32_t backlog = q->head - q->tail;
+    if(backlog >= WQ_RING){
+        q->dropped++;
+        irq_restore(flags);
+        return -1;
+    }
+    struct work_item *w = &q->ring[q->head & (WQ_RING-1)];
+    w->fn  = fn;
+    w->arg = arg;
+    w->tsc = rdtsc();
+    q->head++;
+    q->enqueued++;
+    if(backlog + 1 > q->max_backlog) q->max_backlog = backlog + 1;
+
+    irq_restore(flags);
+
+    if(q->mode == WQ_MODE_WORKER && worker_id >= 0) task_wake(worker_id);
+    return 0;
+}
+
+/* run everything queued on q; returns the number of items run */
+static uint32_t workq_drain(struct workq *q){
+    uint32_t n = 0;
+    while(q->tail != q->head){
+        struct work_item w = q->ring[q->tail & (WQ_RING-1)];
+        q->tail++;
+        uint64_t lat = rdtsc() - w.tsc;
+        q->lat_total += lat;
+        if(lat > q->lat_max) q->lat_max = lat;
+        w.fn(w.arg);
+        q->completed++;
+        n++;
+    }
+    return n;
+}
+
+/* Called with interrupts off at the end of a hard IRQ handler (after
+   EOI). Runs softirq queues with interrupts on; a nested interrupt just
+   enqueues and returns, and this loop picks its work up. */
+void workq_run_irq_exit(void){
+    if(in_softirq) return;
+    in_softirq = 1;
+    __asm__ volatile("sti" ::: "memory");
+    uint32_t ran;
+    do {
+        ran = 0;
+        for(int i=0;i<WQ_NQUEUES;i++)
+            if(queues[i].mode == WQ_MODE_SOFTIRQ) ran += workq_drain(&queues[i]);
+    } while(ran);
+    __asm__ volatile("cli" ::: "memory");
+    in_softirq = 0;
+}
+
+void workq_worker(void *arg){
+    (void)arg;
+    worker_id = task_current_id();
+    for(;;){
+        uint32_t ran = 0;
+        for(int i=0;i<WQ_NQUEUES;i++)
+            if(queues[i].mode == WQ_MODE_WORKER) ran += workq_drain(&queues[i]);
+        if(ran) continue;
+
+        /* block unless something arrived since the drain */
+        uint32_t flags = irq_save();
+        int pending = 0;
+        for(int i=0;i<WQ_NQUEUES;i++)
+            if(queues[i].mode == WQ_MODE_WORKER && queues[i].head != queues[i].tail) pending = 1;
+        if(!pending) task_block();
+        irq_restore(flags);
+    }
+}
+
+static void write_col(const char *s, int w){
+    int n = 0;
+    while(s[n]) n++;
+    for(int i=n;i<w;i++) vga_write(" ");
+    vga_write(s);
+}
+
+static void write_num(uint32_t v, int w){
+    char b[16]; shell_utoa32(v, b); write_col(b, w);
+}
+
+void workq_stats_print(void){
+    vga_writeln("queue   mode      enq     run  drop maxq  avg_ns  max_ns");
+    for(int i=0;i<WQ_NQUEUES;i++){
+        struct workq *q = &queues[i];
+        vga_write(q->name);
+        int len = 0; while(q->name[len]) len++;
+        for(int k=len;k<8;k++) vga_write(" ");
+        vga_write(q->mode == WQ_MODE_SOFTIRQ ? "softirq" : "worker ");
+        write_num(q->enqueued, 6);
+        write_num(q->completed, 8);
+        write_num(q->dropped, 6);
+        write_num(q->max_backlog, 5);
+        uint64_t avg = q->completed ? div64_32(q->lat_total, q->completed, 0) : 0;
+        write_num((uint32_t)tsc_to_ns(avg), 8);
+        write_num((uint32_t)tsc_to_ns(q->lat_max), 8);
+        uint32_t backlog = q->head - q->tail;
+        if(backlog){ vga_write("  backlog="); write_num(backlog, 0); }
+        vga_writeln("");
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef WORKQ_H
+#define WORKQ_H
+#include <stdint.h>
+
+/* Deferred work (bottom halves).
+   Interrupt handlers only enqueue work items into their source's ring.
+   Softirq queues are drained at interrupt exit with interrupts enabled;
+   worker queues are drained by the `kworker` kernel task. */
+
+#define WQ_TIMER    0       /* softirq: scheduler tick bookkeeping */
+#define WQ_KBD      1       /* softirq: scancode decoding */
+#define WQ_DEFER    2       /* worker: general deferred work */
+#define WQ_RTC      3       /* softirq: RTC resync after the update-ended IRQ */
+#define WQ_NQUEUES  4
+
+typedef void (*work_fn)(uint32_t arg);
+
+void workq_init(void);
+
+/* safe from IRQ and task context; returns -1 (and counts a drop) if full */
+int  workq_queue(int q, work_fn fn, uint32_t arg);
+
+/* called by interrupt handlers after EOI */
+void workq_run_irq_exit(void);
+
+/* entry point of the worker task (create with task_create_ex) */
+void workq_worker(void *arg);
+
+void workq_stats_print(void);
+
+#endif
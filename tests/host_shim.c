@@ -0,0 +1,95 @@
+/* Host-side stand-ins for hardware and for kernel modules that are not
+   part of a given test binary. Everything is weak so a test can link the
+   real module instead. */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+/* VGA text buffer in RAM (vga.c points at this under -DHOSTED) */
+uint16_t host_vga_mem[80*25];
+
+/* fake CMOS: port 0x70 selects, 0x71 reads */
+uint8_t host_cmos[128];
+static uint8_t cmos_index;
+
+/* fake 8042 data port */
+uint8_t host_kbd_data;
+
+__attribute__((weak)) uint8_t host_inb(uint16_t p){
+    if(p == 0x71) return host_cmos[cmos_index & 0x7F];
+    if(p == 0x60) return host_kbd_data;
+    return 0;
+}
+
+__attribute__((weak)) void host_outb(uint16_t p, uint8_t v){
+    if(p == 0x70) cmos_index = v;
+}
+
+/* fake timer */
+uint32_t host_ticks;
+__attribute__((weak)) uint32_t timer_ticks(void){ return host_ticks; }
+__attribute__((weak)) uint32_t timer_hz(void){ return 100; }
+__attribute__((weak)) void timer_nohz_kick(void){ }
+__attribute__((weak)) void task_idle_wait(void){ host_ticks++; }
+
+/* framebuffer console: never active on the host */
+__attribute__((weak)) int fbcon_active(void){ return 0; }
+__attribute__((weak)) uint32_t fbcon_cols(void){ return 0; }
+__attribute__((weak)) uint32_t fbcon_rows(void){ return 0; }
+__attribute__((weak)) void fbcon_put_cell(uint32_t x, uint32_t y, uint16_t c){ (void)x; (void)y; (void)c; }
+__attribute__((weak)) uint16_t fbcon_get_cell(uint32_t x, uint32_t y){ (void)x; (void)y; return 0; }
+__attribute__((weak)) void fbcon_scroll(uint8_t a){ (void)a; }
+__attribute__((weak)) void fbcon_clear(uint8_t a){ (void)a; }
+__attribute__((weak)) void fbcon_flush(void){ }
+
+/* console sink for modules linked without vga.c */
+__attribute__((weak)) void vga_write(const char* s){ (void)s; }
+__attribute__((weak)) void vga_writeln(const char* s){ (void)s; }
+__attribute__((weak)) void vga_putc(char c){ (void)c; }
+__attribute__((weak)) int vga_mirrors_serial(void){ return 0; }
+__attribute__((weak)) void vga_hold(void){ }
+__attribute__((weak)) void vga_release(void){ }
+
+/* arch hooks used by task.c / kbd.c */
+__attribute__((weak)) void gdt_set_kernel_stack(uint32_t esp0){ (void)esp0; }
+__attribute__((weak)) void syscall_set_kernel_stack(uint32_t esp0){ (void)esp0; }
+__attribute__((weak)) void paging_switch(uint32_t *dir){ (void)dir; }
+__attribute__((weak)) int paging_map_identity(uint32_t a, uint32_t n, uint32_t f){ (void)a; (void)n; (void)f; return 0; }
+__attribute__((weak)) void irq_eoi(int irq){ (void)irq; }
+__attribute__((weak)) void scheduler_maybe_yield(void){ }
+
+/* scheduler and clock entry points for modules linked without task.c / tsc.c */
+__attribute__((weak)) int task_create(void (*entry)(void)){ (void)entry; return -1; }
+struct task_attrs;
+__attribute__((weak)) int task_create_ex(const struct task_attrs *a){ (void)a; return -1; }
+__attribute__((weak)) uint32_t task_sleep(uint32_t t){ return host_ticks += t; }
+__attribute__((weak)) void task_exit(void){ abort(); }
+__attribute__((weak)) int task_kill(int id){ (void)id; return -1; }
+__attribute__((weak)) int task_current_id(void){ return 0; }
+__attribute__((weak)) void task_yield(void){ }
+__attribute__((weak)) void task_block(void){ }
+__attribute__((weak)) void task_wake(int id){ (void)id; }
+__attribute__((weak)) uint32_t task_switch_count(void){ return 0; }
+__attribute__((weak)) void coro_key_event(char c){ (void)c; }
+__attribute__((weak)) uint32_t tsc_khz(void){ return 1000000; }     /* 1 GHz: cycles == ns */
+__attribute__((weak)) uint64_t tsc_to_ns(uint64_t c){ return c; }
+__attribute__((weak)) uint64_t tsc_to_us(uint64_t c){ return c / 1000; }
+__attribute__((weak)) uint32_t timer_irq_delay_ns(void){ return 0; }
+
+/* no UART on the host */
+__attribute__((weak)) void serial_putc(char c){ (void)c; }
+__attribute__((weak)) void serial_write(const char *s){ (void)s; }
+
+typedef void (*work_fn)(uint32_t arg);
+/* no deferral on the host: run bottom halves immediately */
+__attribute__((weak)) int workq_queue(int q, work_fn fn, uint32_t arg){ (void)q; fn(arg); return 0; }
+__attribute__((weak)) void workq_run_irq_exit(void){ }
+
+/* heap for kalloc: the kernel keeps addresses in uint32_t, so the
+   region must sit below 4 GiB */
+uint32_t host_heap_region(size_t len){
+    void *p = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if(p == MAP_FAILED) return 0;
+    return (uint32_t)(uintptr_t)p;
+}
@@ -0,0 +1,47 @@
+#ifndef TEST_H
+#define TEST_H
+/* Minimal unit test / microbenchmark helpers for the hosted build. */
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+static int test_failures = 0;
+static int test_checks = 0;
+
+#define CHECK(cond) do { \
+    test_checks++; \
+    if(!(cond)){ test_failures++; printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); } \
+} while(0)
+
+#define CHECK_EQ(a, b) do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    test_checks++; \
+    if(_a != _b){ test_failures++; printf("  FAIL %s:%d: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); } \
+} while(0)
+
+#define RUN(fn) do { printf("%s\n", #fn); fn(); } while(0)
+
+static inline uint64_t test_now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* run `body` iters times (in batches, with `setup` before each batch) and print ns/op */
+#define BENCH(name, iters, batch, setup, body) do { \
+    uint64_t _total = 0; \
+    for(long _b = 0; _b < (iters) / (batch); _b++){ \
+        setup; \
+        uint64_t _t0 = test_now_ns(); \
+        for(long _i = 0; _i < (batch); _i++){ body; } \
+        _total += test_now_ns() - _t0; \
+    } \
+    printf("  bench %-28s %8.2f ns/op\n", name, (double)_total / (double)(iters)); \
+} while(0)
+
+static inline int test_summary(const char* name){
+    printf("%s: %d checks, %d failures\n", name, test_checks, test_failures);
+    return test_failures ? 1 : 0;
+}
+
+#endif
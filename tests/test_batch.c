@@ -0,0 +1,69 @@
+#include "test.h"
+#include <string.h>
+#include "../src/batch.c"
+
+/* executed commands and sleeps, as "cmd|cmd|s10|" */
+static char trace[2048];
+static size_t tlen;
+static void tr(const char *s){ while(*s && tlen + 1 < sizeof(trace)) trace[tlen++] = *s++; trace[tlen] = 0; }
+static void fake_exec(const char *cmd){ tr(cmd); tr("|"); }
+static void fake_sleep(uint32_t ms){ char b[16]; snprintf(b, sizeof(b), "s%u|", ms); tr(b); }
+static const struct batch_ops ops = { fake_exec, fake_sleep };
+
+static int run(const char *script){
+    tlen = 0; trace[0] = 0;
+    return batch_run(script, (uint32_t)strlen(script), &ops);
+}
+
+static void test_plain(void){
+    CHECK_EQ(run("taskrun; tstat\n# comment\n\n  echo hi there  \r\n"), 3);
+    CHECK(strcmp(trace, "taskrun|tstat|echo hi there|") == 0);
+    CHECK_EQ(run(""), 0);
+    CHECK_EQ(run("sleepy"), 1);                 /* not the sleep keyword */
+    CHECK(strcmp(trace, "sleepy|") == 0);
+}
+
+static void test_directives(void){
+    CHECK_EQ(run("repeat 3 sysbench; sleep 250; tstat"), 4);
+    CHECK(strcmp(trace, "sysbench|sysbench|sysbench|s250|tstat|") == 0);
+    CHECK_EQ(run("loop 2\n  a\n  loop 2; b; end\nend\nc"), 7);
+    CHECK(strcmp(trace, "a|b|b|a|b|b|c|") == 0);
+    CHECK_EQ(run("loop 0; a; end; repeat 0 b; c"), 1);
+    CHECK(strcmp(trace, "c|") == 0);
+}
+
+static void test_module_text(void){
+    /* module images are not NUL-terminated and may have trailing padding */
+    const char img[] = "uptime\nsleep 5\0garbage";
+    tlen = 0;
+    CHECK_EQ(batch_run(img, sizeof(img) - 1, &ops), 1);
+    CHECK(strcmp(trace, "uptime|s5|") == 0);
+}
+
+static void test_errors(void){
+    /* nothing runs when the script does not parse */
+    CHECK_EQ(run("a; loop 2; b"), -1);
+    CHECK_EQ(tlen, 0);
+    CHECK_EQ(run("a; end"), -1);
+    CHECK_EQ(run("repeat x a"), -1);
+    CHECK_EQ(run("repeat 3"), -1);
+    CHECK_EQ(run("sleep"), -1);
+    CHECK_EQ(run("sleep 10 20"), -1);
+    CHECK_EQ(run("loop 2 x; end"), -1);
+    CHECK_EQ(run("loop 1; loop 1; loop 1; loop 1; loop 1; end; end; end; end; end"), -1);
+    CHECK_EQ(run("loop 1; loop 1; loop 1; loop 1; a; end; end; end; end"), 1);
+
+    char big[4096] = "";
+    for(int i=0;i<BATCH_MAX_STMTS+1;i++) strcat(big, "x;");
+    CHECK_EQ(run(big), -1);
+    memset(big, 'y', CMD_MAX_LEN + 10); big[CMD_MAX_LEN + 10] = 0;
+    CHECK_EQ(run(big), -1);
+}
+
+int main(void){
+    RUN(test_plain);
+    RUN(test_directives);
+    RUN(test_module_text);
+    RUN(test_errors);
+    return test_summary("batch");
+}
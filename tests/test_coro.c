@@ -0,0 +1,154 @@
+#include "test.h"
+#include <string.h>
+#include "../src/coro.c"
+
+extern uint32_t host_ticks;
+
+static char trace[64];
+static int ntrace;
+
+static int yield_fn(struct coro *c){
+    CORO_BEGIN(c);
+    for(c->i = 0; c->i < 3; c->i++){
+        trace[ntrace++] = *(const char*)c->arg;
+        CORO_YIELD(c);
+    }
+    CORO_END(c);
+}
+
+static void test_round_robin(void){
+    struct coro a, b, d;
+    ntrace = 0;
+    coro_start(&a, yield_fn, "a");
+    coro_start(&b, yield_fn, "b");
+    coro_start(&d, yield_fn, "c");
+    CHECK_EQ(live, 3);
+    CHECK_EQ(coro_run(), 3);
+    CHECK_EQ(coro_run(), 3);
+    CHECK_EQ(coro_run(), 3);
+    CHECK(!coro_done(&a));
+    CHECK_EQ(coro_run(), 3);             /* the pass that leaves the loop */
+    trace[ntrace] = 0;
+    CHECK(strcmp(trace, "abcabcabc") == 0);
+    CHECK(coro_done(&a) && coro_done(&b) && coro_done(&d));
+    CHECK_EQ(live, 0);
+    CHECK_EQ(coro_run(), 0);
+}
+
+static int sleep_fn(struct coro *c){
+    CORO_BEGIN(c);
+    CORO_SLEEP(c, (uint32_t)(uintptr_t)c->arg);
+    c->i = timer_ticks();
+    CORO_END(c);
+}
+
+static void test_sleep(void){
+    struct coro s[4];
+    static const uint32_t ticks[4] = { 5, 2, 0, 70 };   /* 70: a second lap of the wheel */
+    host_ticks = 1000;
+    coro_run();
+    for(int i=0;i<4;i++) coro_start(&s[i], sleep_fn, (void*)(uintptr_t)ticks[i]);
+    coro_run();
+    CHECK_EQ(ntimers, 3);
+    CHECK_EQ(coro_run(), 1);             /* the zero-tick sleeper */
+    CHECK(coro_done(&s[2]));
+    CHECK_EQ(s[2].i, 1000);
+
+    for(uint32_t t = 1001; t <= 1080; t++){
+        host_ticks = t;
+        coro_run();
+        CHECK_EQ(coro_done(&s[1]), t >= 1002);
+        CHECK_EQ(coro_done(&s[0]), t >= 1005);
+        CHECK_EQ(coro_done(&s[3]), t >= 1070);
+    }
+    CHECK_EQ(s[1].i, 1002);
+    CHECK_EQ(s[0].i, 1005);
+    CHECK_EQ(s[3].i, 1070);
+    CHECK_EQ(ntimers, 0);
+
+    /* a long gap (nohz) still expires everything that is due */
+    coro_start(&s[0], sleep_fn, (void*)3);
+    coro_start(&s[1], sleep_fn, (void*)500);
+    coro_run();
+    host_ticks += 200;
+    coro_run();
+    CHECK(coro_done(&s[0]));
+    CHECK(!coro_done(&s[1]));
+    CHECK_EQ(next_deadline(host_ticks), CORO_WHEEL);    /* due in a later lap */
+    CHECK_EQ(next_deadline(host_ticks + 1), 0);         /* wheel behind the clock */
+    host_ticks += 299;
+    coro_run();
+    CHECK_EQ(next_deadline(host_ticks), 1);
+    host_ticks += 1;
+    coro_run();
+    CHECK(coro_done(&s[1]));
+    CHECK_EQ(next_deadline(host_ticks), -1);
+}
+
+static int key_fn(struct coro *c){
+    CORO_BEGIN(c);
+    CORO_AWAIT_KEY(c);
+    trace[ntrace++] = c->key;
+    CORO_AWAIT_KEY(c);
+    trace[ntrace++] = c->key;
+    CORO_END(c);
+}
+
+static void test_keys(void){
+    struct coro k1, k2;
+    ntrace = 0;
+    coro_key_event('z');                 /* before anyone waits: no effect */
+    coro_start(&k1, key_fn, 0);
+    coro_run();
+    CHECK_EQ(nkbd, 1);
+    CHECK_EQ(coro_run(), 0);
+    CHECK_EQ(ntrace, 0);
+
+    coro_key_event('x');
+    coro_start(&k2, key_fn, 0);          /* starts waiting after 'x' */
+    CHECK_EQ(coro_run(), 2);             /* k1 woken, k2 starts waiting */
+    CHECK_EQ(ntrace, 1);
+    CHECK_EQ(trace[0], 'x');
+    CHECK_EQ(nkbd, 2);
+
+    coro_key_event('y');
+    CHECK_EQ(coro_run(), 2);
+    CHECK_EQ(ntrace, 3);
+    CHECK(coro_done(&k1));
+    CHECK(!coro_done(&k2));
+    CHECK_EQ(k2.key, 'y');
+    coro_key_event('w');
+    coro_run();
+    CHECK(coro_done(&k2));
+    CHECK_EQ(nkbd, 0);
+}
+
+static int spin_fn(struct coro *c){
+    CORO_BEGIN(c);
+    for(;;) CORO_YIELD(c);
+    CORO_END(c);
+}
+
+#define BENCH_N 1000
+static struct coro pool[BENCH_N];
+
+static void bench(void){
+    uint64_t t0 = test_now_ns();
+    for(int i=0;i<BENCH_N;i++) coro_start(&pool[i], spin_fn, 0);
+    printf("  bench %-28s %8.2f ns/op\n", "coro_start", (double)(test_now_ns() - t0) / BENCH_N);
+
+    uint32_t r0 = resumes;
+    t0 = test_now_ns();
+    for(int i=0;i<2000;i++) coro_run();
+    printf("  bench %-28s %8.2f ns/op\n", "resume + yield (1000 ready)",
+           (double)(test_now_ns() - t0) / (double)(resumes - r0));
+    printf("  sizeof(struct coro) = %u bytes\n", (unsigned)sizeof(struct coro));
+}
+
+int main(void){
+    RUN(test_round_robin);
+    RUN(test_sleep);
+    RUN(test_keys);
+    RUN(bench);
+    return test_summary("coro");
+}
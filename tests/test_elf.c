@@ -0,0 +1,104 @@
+#include "test.h"
+#include <string.h>
+#include "../src/elf.c"
+
+#define LO 0x40000000u
+#define HI 0xBFFF0000u
+
+/* ehdr + text (R X, page aligned) + data (RW, with .bss) in 0x3000 bytes */
+static uint8_t img[0x3000];
+
+static struct elf32_ehdr* eh(void){ return (struct elf32_ehdr*)img; }
+static struct elf32_phdr* ph(int i){ return (struct elf32_phdr*)(img + sizeof(struct elf32_ehdr)) + i; }
+
+static void build(void){
+    memset(img, 0, sizeof(img));
+    struct elf32_ehdr *h = eh();
+    h->e_ident[0] = 0x7F; h->e_ident[1] = 'E'; h->e_ident[2] = 'L'; h->e_ident[3] = 'F';
+    h->e_ident[4] = ELFCLASS32; h->e_ident[5] = ELFDATA2LSB;
+    h->e_type = ET_EXEC; h->e_machine = EM_386; h->e_version = 1;
+    h->e_entry = LO + 0x10;
+    h->e_phoff = sizeof(struct elf32_ehdr);
+    h->e_ehsize = sizeof(struct elf32_ehdr);
+    h->e_phentsize = sizeof(struct elf32_phdr);
+    h->e_phnum = 2;
+    *ph(0) = (struct elf32_phdr){ PT_LOAD, 0x1000, LO, LO, 0x100, 0x100, PF_R|PF_X, 0x1000 };
+    *ph(1) = (struct elf32_phdr){ PT_LOAD, 0x2000, LO+0x1000, LO+0x1000, 0x10, 0x8000, PF_R|PF_W, 0x1000 };
+}
+
+static int check(uint32_t len, const char **err){
+    *err = 0;
+    return elf_check(img, len, LO, HI, err);
+}
+
+static void test_valid(void){
+    const char *err;
+    build();
+    CHECK_EQ(check(sizeof(img), &err), 0);
+    CHECK(err == 0);
+    CHECK(elf_phdr(img, 1) == ph(1));
+    CHECK_EQ(elf_phdr(img, 1)->p_memsz, 0x8000);
+}
+
+static void test_header(void){
+    const char *err;
+    build(); img[1] = 'X';
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    CHECK(err && strcmp(err, "not an ELF file") == 0);
+    build(); img[4] = 2;
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    build(); eh()->e_machine = 62;
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    CHECK(err && strcmp(err, "not i386") == 0);
+    build(); eh()->e_type = 3;
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    build();
+    CHECK_EQ(check(20, &err), -1);
+    CHECK(err && strcmp(err, "truncated header") == 0);
+    build(); eh()->e_phnum = 0xFFFF;
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    build(); eh()->e_phoff = 0xFFFFFFF0u;
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    CHECK(err && strcmp(err, "program headers past end of file") == 0);
+}
+
+static void test_segments(void){
+    const char *err;
+    build(); ph(1)->p_offset = 0x2FF8;          /* file range runs past the image */
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    CHECK(err && strcmp(err, "segment past end of file") == 0);
+    build(); ph(1)->p_offset = 0xFFFFFFF8u;     /* offset + filesz wraps */
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    build(); ph(1)->p_filesz = 0x9000;
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    CHECK(err && strcmp(err, "filesz > memsz") == 0);
+    build(); ph(0)->p_vaddr = 0x00100000;       /* inside the kernel's identity map */
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    CHECK(err && strcmp(err, "segment outside user range") == 0);
+    build(); ph(1)->p_memsz = 0xFFFFFFF0u;      /* vaddr + memsz wraps */
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    build(); eh()->e_entry = LO + 0x1000;       /* entry in the data segment */
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    CHECK(err && strcmp(err, "entry not in an executable segment") == 0);
+    build(); ph(0)->p_type = 6; ph(1)->p_type = 6;
+    CHECK_EQ(check(sizeof(img), &err), -1);
+    CHECK(err && strcmp(err, "no PT_LOAD segments") == 0);
+    build(); ph(1)->p_type = 0x6474E551;        /* PT_GNU_STACK is ignored */
+    CHECK_EQ(check(sizeof(img), &err), 0);
+}
+
+static void bench(void){
+    const char *err;
+    volatile int r = 0;
+    build();
+    BENCH("elf_check", 4000000, 100000, (void)0, r += elf_check(img, sizeof(img), LO, HI, &err));
+    (void)r;
+}
+
+int main(void){
+    RUN(test_valid);
+    RUN(test_header);
+    RUN(test_segments);
+    RUN(bench);
+    return test_summary("elf");
+}
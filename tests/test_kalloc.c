@@ -0,0 +1,139 @@
+#include "test.h"
+#include "../src/kalloc.c"
+
+uint32_t host_heap_region(size_t len);
+
+#define HEAP_LEN (16u << 20)
+static uint32_t heap;
+
+static void test_uninitialised(void){
+    /* kalloc_init(0) is ignored and kmalloc fails until a real init */
+    kalloc_init(0);
+    CHECK(kmalloc(16) == 0);
+}
+
+static void test_bump_and_align(void){
+    kalloc_init(heap + 3);
+    CHECK_EQ(kalloc_get_start(), heap + 3);
+    uint8_t *a = kmalloc(1);
+    uint8_t *b = kmalloc(13);
+    uint8_t *c = kmalloc(8);
+    CHECK_EQ((uintptr_t)a % 8, 0);
+    CHECK_EQ((uintptr_t)b % 8, 0);
+    CHECK_EQ((uintptr_t)c % 8, 0);
+    CHECK(b > a && c > b);
+    CHECK_EQ((uintptr_t)b - (uintptr_t)a, 8);
+    CHECK_EQ((uintptr_t)c - (uintptr_t)b, 16);
+    CHECK_EQ(kalloc_get_ptr(), (uint32_t)(uintptr_t)c + 8);
+    CHECK_EQ(kalloc_bytes_used(), kalloc_get_ptr() - (heap + 3));
+}
+
+static void test_aligned(void){
+    kalloc_init(heap);
+    kmalloc(24);
+    uint8_t *p = kmalloc_aligned(4096, 4096);
+    CHECK_EQ((uintptr_t)p % 4096, 0);
+    CHECK_EQ(kalloc_get_ptr(), (uint32_t)(uintptr_t)p + 4096);
+    uint8_t *q = kmalloc_aligned(10, 2);      /* still at least 8 */
+    CHECK_EQ((uintptr_t)q % 8, 0);
+}
+
+#ifdef KALLOC_TRACE
+static int cur_task = -1;
+int task_current_id(void){ return cur_task; }
+
+/* the empty asm keeps the calls from becoming tail jumps */
+static __attribute__((noinline)) void* alloc_a(size_t n){
+    void *p = kmalloc(n); __asm__ volatile("" : "+r"(p)); return p;
+}
+static __attribute__((noinline)) void* alloc_b(size_t n){
+    void *p = kmalloc_aligned(n, 64); __asm__ volatile("" : "+r"(p)); return p;
+}
+
+static const struct kmprof_site* find_site(uint32_t lo, uint32_t hi){
+    const struct kmprof_site *s = kmprof_sites(0), *hit = 0;
+    for(uint32_t i=0;i<KMPROF_SITES;i++)
+        if(s[i].count && s[i].site >= lo && s[i].site < hi){ CHECK(hit == 0); hit = &s[i]; }
+    return hit;
+}
+
+static void test_trace_sites(void){
+    kalloc_init(heap);
+    kmprof_reset();
+    cur_task = 3;
+    alloc_a(8); alloc_a(16); alloc_a(17); alloc_a(300);
+    alloc_b(4096); alloc_b(100000);
+    cur_task = 4;
+    alloc_b(64);
+
+    uint32_t lost = 1;
+    kmprof_sites(&lost);
+    CHECK_EQ(lost, 0);
+    /* each helper is one call site inside its own body */
+    const struct kmprof_site *a = find_site((uint32_t)(uintptr_t)alloc_a, (uint32_t)(uintptr_t)alloc_a + 64);
+    const struct kmprof_site *b = find_site((uint32_t)(uintptr_t)alloc_b, (uint32_t)(uintptr_t)alloc_b + 64);
+    CHECK(a != 0 && b != 0);
+    if(!a || !b) return;
+    CHECK_EQ(a->count, 4);
+    CHECK_EQ(a->bytes, 8 + 16 + 17 + 300);
+    CHECK_EQ(a->task, 3);
+    CHECK_EQ(a->hist[0], 2);            /* 8, 16 */
+    CHECK_EQ(a->hist[1], 1);            /* 17 */
+    CHECK_EQ(a->hist[3], 1);            /* 300 */
+    CHECK_EQ(b->count, 3);
+    CHECK_EQ(b->task, KMPROF_MANY_TASKS);
+    CHECK_EQ(b->hist[4], 1);            /* 4096 */
+    CHECK_EQ(b->hist[1], 1);            /* 64 */
+    CHECK_EQ(b->hist[KMPROF_BUCKETS - 1], 1);
+
+    struct kmprof_rec r[4];
+    CHECK_EQ(kmprof_recent(r, 4), 4);
+    CHECK_EQ(r[0].size, 64);
+    CHECK_EQ(r[0].task, 4);
+    CHECK_EQ(r[0].site, b->site);
+    CHECK_EQ(r[0].addr % 64, 0);
+    CHECK_EQ(r[3].size, 300);
+
+    kmprof_reset();
+    CHECK_EQ(kmprof_recent(r, 4), 0);
+    CHECK(find_site(0, 0xFFFFFFFFu) == 0);
+}
+
+static void test_trace_table_full(void){
+    kalloc_init(heap);
+    kmprof_reset();
+    /* fake return addresses: more distinct sites than slots */
+    for(uint32_t i=0;i<KMPROF_SITES + 5;i++) trace_alloc(0x1000 + i * 4, 32, heap);
+    trace_alloc(0x1000, 32, heap);
+    uint32_t lost;
+    const struct kmprof_site *s = kmprof_sites(&lost);
+    CHECK_EQ(lost, 5);
+    uint32_t used = 0, total = 0;
+    for(uint32_t i=0;i<KMPROF_SITES;i++) if(s[i].count){ used++; total += s[i].count; }
+    CHECK_EQ(used, KMPROF_SITES);
+    CHECK_EQ(total, KMPROF_SITES + 1);
+    kmprof_reset();
+}
+#endif
+
+static void bench(void){
+    BENCH("kmalloc(16)", 4000000, 100000, kalloc_init(heap), kmalloc(16));
+    BENCH("kmalloc_aligned(64, 64)", 4000000, 100000, kalloc_init(heap), kmalloc_aligned(64, 64));
+}
+
+int main(void){
+    heap = host_heap_region(HEAP_LEN);
+    if(!heap){ printf("no low memory for the heap\n"); return 1; }
+    RUN(test_uninitialised);
+    RUN(test_bump_and_align);
+    RUN(test_aligned);
+#ifdef KALLOC_TRACE
+    RUN(test_trace_sites);
+    RUN(test_trace_table_full);
+    RUN(bench);
+    return test_summary("kalloc (KALLOC_TRACE)");
+#else
+    RUN(bench);
+    return test_summary("kalloc");
+#endif
+}
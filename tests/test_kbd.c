@@ -0,0 +1,75 @@
+#include "test.h"
+#include "../src/kbd.c"
+
+extern uint8_t host_kbd_data;
+
+static void test_decode(void){
+    CHECK_EQ(kbd_decode(0x1E), 'a');
+    CHECK_EQ(kbd_decode(0x02), '1');
+    CHECK_EQ(kbd_decode(0x1C), '\n');
+    CHECK_EQ(kbd_decode(0x0E), 8);
+    CHECK_EQ(kbd_decode(0x39), ' ');
+    CHECK_EQ(kbd_decode(0x9E), 0);      /* release */
+    CHECK_EQ(kbd_decode(0xE0), 0);      /* extended prefix */
+    CHECK_EQ(kbd_decode(0x3B), 0);      /* F1: unmapped */
+}
+
+static void test_shift(void){
+    CHECK_EQ(kbd_decode(0x2A), 0);      /* left shift down */
+    CHECK_EQ(kbd_decode(0x1E), 'A');
+    CHECK_EQ(kbd_decode(0x02), '!');
+    CHECK_EQ(kbd_decode(0xAA), 0);      /* left shift up */
+    CHECK_EQ(kbd_decode(0x1E), 'a');
+    CHECK_EQ(kbd_decode(0x36), 0);      /* right shift */
+    CHECK_EQ(kbd_decode(0x27), ':');
+    CHECK_EQ(kbd_decode(0xB6), 0);
+    CHECK_EQ(kbd_decode(0x27), ';');
+}
+
+static void press(uint8_t sc){
+    host_kbd_data = sc;
+    kbd_isr();
+}
+
+static void test_fifo(void){
+    press(0x23); press(0xA3);           /* h */
+    press(0x17); press(0x97);           /* i */
+    press(0x1C);                        /* enter */
+    CHECK_EQ(kbd_getch(), 'h');
+    CHECK_EQ(kbd_getch(), 'i');
+    CHECK_EQ(kbd_getch(), '\n');
+    CHECK(fifo_head == fifo_tail);
+
+    CHECK_EQ(kbd_trygetch(), 0);
+    press(0x10);                        /* q */
+    CHECK_EQ(kbd_trygetch(), 'q');
+    CHECK_EQ(kbd_trygetch(), 0);
+}
+
+/* kbd_getch on an empty FIFO blocks; the "IRQ" arrives while blocked */
+static int blocks, woken = -1;
+int task_current_id(void){ return 7; }
+void task_block(void){ blocks++; press(0x30); press(0xB0); }    /* b */
+void task_wake(int id){ woken = id; }
+
+static void test_blocking_getch(void){
+    blocks = 0;
+    CHECK_EQ(kbd_getch(), 'b');
+    CHECK_EQ(blocks, 1);
+    CHECK_EQ(woken, 7);
+    CHECK_EQ(reader, -1);
+
+    woken = -1;
+    press(0x30);                        /* nobody waiting: no wakeup */
+    CHECK_EQ(kbd_getch(), 'b');
+    CHECK_EQ(blocks, 1);
+    CHECK_EQ(woken, -1);
+}
+
+int main(void){
+    RUN(test_decode);
+    RUN(test_shift);
+    RUN(test_fifo);
+    RUN(test_blocking_getch);
+    return test_summary("kbd");
+}
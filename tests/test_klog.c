@@ -0,0 +1,109 @@
+#include "test.h"
+#include <string.h>
+#include "../src/klog.c"
+
+/* console capture (overrides the weak shim stubs) */
+static char con[8192];
+static size_t con_len;
+static void con_add(const char *s){ while(*s && con_len + 1 < sizeof(con)) con[con_len++] = *s++; con[con_len] = 0; }
+void vga_write(const char *s){ con_add(s); }
+void vga_writeln(const char *s){ con_add(s); con_add("\n"); }
+static void con_reset(void){ con_len = 0; con[0] = 0; }
+
+static char b[128];
+
+#define FMT_EQ(expect, ...) do { ksnprintf(b, sizeof(b), __VA_ARGS__); \
+    test_checks++; if(strcmp(b, expect)){ test_failures++; printf("  FAIL %s:%d: \"%s\" != \"%s\"\n", __FILE__, __LINE__, b, expect); } } while(0)
+
+static void test_format(void){
+    FMT_EQ("42 -7 0", "%d %d %u", 42, -7, 0u);
+    FMT_EQ("4294967295", "%u", 0xFFFFFFFFu);
+    FMT_EQ("-2147483648", "%d", (int)0x80000000u);
+    FMT_EQ("ff FF 0", "%x %X %x", 255u, 255u, 0u);
+    FMT_EQ("123456789abcdef0", "%llx", 0x123456789ABCDEF0ull);
+    FMT_EQ("18446744073709551615", "%llu", ~0ull);
+    FMT_EQ("-9000000000", "%lld", -9000000000ll);
+    FMT_EQ("[   7][7   ][0007][-007]", "[%4u][%-4u][%04u][%04d]", 7u, 7u, 7u, -7);
+    FMT_EQ("[  ab][ab  ]", "[%4s][%-4s]", "ab", "ab");
+    FMT_EQ("c=q 100%", "c=%c 100%%", 'q');
+    FMT_EQ("0x0000beef", "%p", (void*)0xBEEF);
+
+    /* truncation keeps the NUL and reports the full length */
+    char small[6];
+    CHECK_EQ(ksnprintf(small, sizeof(small), "%s", "hello world"), 11);
+    CHECK(strcmp(small, "hello") == 0);
+}
+
+static void test_ring(void){
+    con_reset();
+    klog(KLOG_INFO, "first %d", 1);
+    klog(KLOG_WARN, "second\n");                /* trailing newline is dropped */
+    klog(KLOG_DEBUG, "hidden from the console");
+    struct klog_stats st;
+    klog_get_stats(&st);
+    CHECK_EQ(st.pending, 3);
+    CHECK_EQ(con_len, 0);                       /* nothing written synchronously */
+    CHECK_EQ(klog_flush(), 3);
+    CHECK(strcmp(con, "first 1\nsecond\n") == 0);
+    klog_get_stats(&st);
+    CHECK_EQ(st.pending, 0);
+    CHECK_EQ(st.logged, 3);
+
+    /* dmesg replays everything, including the debug record */
+    con_reset();
+    klog_dmesg();
+    CHECK(strstr(con, "I   0 first 1\n") != 0);
+    CHECK(strstr(con, "W   0 second\n") != 0);
+    CHECK(strstr(con, "D   0 hidden from the console\n") != 0);
+}
+
+static void test_full_drops(void){
+    struct klog_stats st0, st;
+    klog_get_stats(&st0);
+    for(int i=0;i<KLOG_RECORDS + 10;i++) klog(KLOG_INFO, "msg %d", i);
+    klog_get_stats(&st);
+    CHECK_EQ(st.pending, KLOG_RECORDS);
+    CHECK_EQ(st.dropped - st0.dropped, 10);
+    con_reset();
+    CHECK_EQ(klog_flush(), KLOG_RECORDS);
+    CHECK(strncmp(con, "msg 0\n", 6) == 0);    /* oldest kept, newest dropped */
+
+    /* the ring keeps the last KLOG_RECORDS lines for dmesg */
+    con_reset();
+    klog_dmesg();
+    CHECK(strstr(con, "msg 127\n") != 0);
+    CHECK(strstr(con, "first 1") == 0);
+
+    /* space again once drained */
+    klog(KLOG_INFO, "after");
+    klog_get_stats(&st);
+    CHECK_EQ(st.pending, 1);
+    klog_flush();
+}
+
+static void test_long_line(void){
+    char big[300];
+    memset(big, 'a', sizeof(big) - 1); big[sizeof(big)-1] = 0;
+    con_reset();
+    klog(KLOG_INFO, "%s", big);
+    klog_flush();
+    CHECK_EQ(con_len, KLOG_TEXT);               /* KLOG_TEXT-1 chars + '\n' */
+}
+
+static void bench(void){
+    struct klog_stats st;
+    BENCH("ksnprintf %u %x %s", 2000000, 100000, (void)0, ksnprintf(b, sizeof(b), "task %u ticks=%x %s", 12345u, 0xBEEFu, "shell"));
+    BENCH("klog + flush", 1000000, KLOG_RECORDS, klog_flush(), klog(KLOG_DEBUG, "[task %d] tick %u", 3, 42u));
+    klog_flush();
+    klog_get_stats(&st);
+    CHECK_EQ(st.pending, 0);
+}
+
+int main(void){
+    RUN(test_format);
+    RUN(test_ring);
+    RUN(test_full_drops);
+    RUN(test_long_line);
+    RUN(bench);
+    return test_summary("klog");
+}
@@ -0,0 +1,75 @@
+#include "test.h"
+#include "../src/latency.c"
+
+static void test_empty(void){
+    struct lat_hist h;
+    lat_hist_reset(&h);
+    CHECK_EQ(h.count, 0);
+    CHECK_EQ(lat_hist_avg(&h), 0);
+    CHECK_EQ(lat_hist_percentile(&h, 99), 0);
+}
+
+static void test_buckets(void){
+    struct lat_hist h;
+    lat_hist_reset(&h);
+    lat_hist_add(&h, 0);
+    lat_hist_add(&h, 1);
+    lat_hist_add(&h, 1023);
+    lat_hist_add(&h, 1024);
+    lat_hist_add(&h, 0xFFFFFFFFu);
+    CHECK_EQ(h.bucket[0], 2);
+    CHECK_EQ(h.bucket[9], 1);
+    CHECK_EQ(h.bucket[10], 1);
+    CHECK_EQ(h.bucket[31], 1);
+    CHECK_EQ(h.min_ns, 0);
+    CHECK_EQ(h.max_ns, 0xFFFFFFFFu);
+}
+
+static void test_stats(void){
+    struct lat_hist h;
+    lat_hist_reset(&h);
+    /* 99 fast samples around 1.5 us, one 100 us outlier */
+    for(int i=0;i<99;i++) lat_hist_add(&h, 1500);
+    lat_hist_add(&h, 100000);
+    CHECK_EQ(h.count, 100);
+    CHECK_EQ(h.min_ns, 1500);
+    CHECK_EQ(h.max_ns, 100000);
+    CHECK_EQ(lat_hist_avg(&h), (99*1500 + 100000) / 100);
+    CHECK_EQ(lat_hist_percentile(&h, 99), 2047);     /* top of [1024, 2048) */
+    CHECK_EQ(lat_hist_percentile(&h, 100), 100000);  /* capped at max */
+    CHECK_EQ(lat_hist_percentile(&h, 50), 2047);
+
+    lat_hist_reset(&h);
+    lat_hist_add(&h, 1500);
+    CHECK_EQ(lat_hist_percentile(&h, 99), 1500);     /* bucket top capped at max */
+}
+
+static void test_tick_stamp(void){
+    tick_cycles = 10000000;                 /* 100 Hz at 1 GHz */
+    for(int i=0;i<LAT_STAMPS;i++) tick_tsc[i] = 0;
+    CHECK_EQ(tick_stamp(5), 0);             /* nothing recorded */
+    for(uint32_t t=100;t<132;t++) record_stamp(t, 1000 + (uint64_t)t * tick_cycles + (t & 1));
+    CHECK_EQ(tick_stamp(131), 1000 + 131ull * tick_cycles + 1);
+    CHECK_EQ(tick_stamp(116), 1000 + 116ull * tick_cycles);
+    /* overwritten: extrapolated from the oldest stamp still held (116) */
+    CHECK_EQ(tick_stamp(105), 1000 + 105ull * tick_cycles);
+    CHECK_EQ(tick_stamp(40), 1000 + 40ull * tick_cycles);
+    /* a tick that was never stamped (dynamic tick) */
+    tick_tsc[120 & (LAT_STAMPS-1)] = 0;
+    CHECK_EQ(tick_stamp(120), 1000 + 120ull * tick_cycles + 1);
+}
+
+static void bench(void){
+    static struct lat_hist h;
+    uint32_t x = 12345;
+    BENCH("lat_hist_add", 4000000, 100000, lat_hist_reset(&h), (x = x * 1103515245u + 12345u, lat_hist_add(&h, x >> 12)));
+}
+
+int main(void){
+    RUN(test_empty);
+    RUN(test_buckets);
+    RUN(test_stats);
+    RUN(test_tick_stamp);
+    RUN(bench);
+    return test_summary("latency");
+}
@@ -0,0 +1,115 @@
+#include "test.h"
+#include "../src/rtc.c"
+
+extern uint8_t host_cmos[128];
+
+/* CMOS model with an update in progress and a rollover in mid-read
+   (replaces the shim's plain port handlers) */
+static uint8_t idx;
+static int uip_reads;               /* reads of register A that still show UIP */
+static int roll_after = -1;         /* reads of register 0 before the time advances */
+static int reg0_reads;
+static void roll(void){             /* BCD 12:59:59 -> 13:00:00 */
+    host_cmos[0x00] = 0x00; host_cmos[0x02] = 0x00; host_cmos[0x04] = 0x13;
+}
+void host_outb(uint16_t p, uint8_t v){ if(p == 0x70) idx = v & 0x7F; else if(p == 0x71) host_cmos[idx] = v; }
+uint8_t host_inb(uint16_t p){
+    if(p != 0x71) return 0xFF;
+    if(idx == 0x0A) return uip_reads > 0 ? (uip_reads--, 0x80) : 0x00;
+    uint8_t v = host_cmos[idx];
+    if(idx == 0x00){ reg0_reads++; if(roll_after >= 0 && roll_after-- == 0) roll(); }
+    return v;
+}
+
+static void set_time(uint8_t sec, uint8_t min, uint8_t hour, uint8_t day, uint8_t mon, uint8_t year, uint8_t regb){
+    host_cmos[0x00] = sec;  host_cmos[0x02] = min; host_cmos[0x04] = hour;
+    host_cmos[0x07] = day;  host_cmos[0x08] = mon; host_cmos[0x09] = year;
+    host_cmos[0x0B] = regb;
+}
+
+static void test_bcd(void){
+    CHECK_EQ(bcd_to_bin(0x00), 0);
+    CHECK_EQ(bcd_to_bin(0x09), 9);
+    CHECK_EQ(bcd_to_bin(0x10), 10);
+    CHECK_EQ(bcd_to_bin(0x59), 59);
+    CHECK_EQ(bcd_to_bin(0x99), 99);
+}
+
+static void test_bcd_24h(void){
+    struct rtc_time t;
+    set_time(0x45, 0x30, 0x23, 0x31, 0x12, 0x24, 0x02);   /* BCD, 24h */
+    rtc_read(&t);
+    CHECK_EQ(t.sec, 45); CHECK_EQ(t.min, 30); CHECK_EQ(t.hour, 23);
+    CHECK_EQ(t.day, 31); CHECK_EQ(t.month, 12); CHECK_EQ(t.year, 2024);
+}
+
+static void test_12h(void){
+    struct rtc_time t;
+    set_time(0x00, 0x00, 0x80 | 0x12, 1, 1, 0x99, 0x00);   /* BCD 12 PM */
+    rtc_read(&t);
+    CHECK_EQ(t.hour, 12);
+    CHECK_EQ(t.year, 1999);
+
+    set_time(0x00, 0x00, 0x12, 1, 1, 0, 0x00);            /* BCD 12 AM */
+    rtc_read(&t);
+    CHECK_EQ(t.hour, 0);
+
+    set_time(0x00, 0x00, 0x80 | 0x07, 1, 1, 0, 0x00);     /* BCD 7 PM */
+    rtc_read(&t);
+    CHECK_EQ(t.hour, 19);
+
+    set_time(5, 6, 0x80 | 11, 2, 3, 30, 0x04);             /* binary 11 PM */
+    rtc_read(&t);
+    CHECK_EQ(t.hour, 23); CHECK_EQ(t.sec, 5); CHECK_EQ(t.min, 6);
+    CHECK_EQ(t.year, 2030);
+}
+
+static void test_uip_and_torn_read(void){
+    struct rtc_time t;
+    set_time(0x59, 0x59, 0x12, 0x01, 0x01, 0x24, 0x02);
+    uip_reads = 50;
+    rtc_read(&t);
+    CHECK_EQ(uip_reads, 0);                     /* waited the update out */
+    CHECK_EQ(t.hour, 12); CHECK_EQ(t.sec, 59);
+
+    /* seconds read as 59, then the RTC rolls over before minute and hour:
+       a single pass would return 12:00:59 or 13:00:59 */
+    set_time(0x59, 0x59, 0x12, 0x01, 0x01, 0x24, 0x02);
+    roll_after = 0;
+    reg0_reads = 0;
+    rtc_read(&t);
+    CHECK_EQ(t.hour, 13); CHECK_EQ(t.min, 0); CHECK_EQ(t.sec, 0);
+    CHECK_EQ(reg0_reads, 3);                    /* torn pass, then two matching */
+    roll_after = -1;
+}
+
+static void test_unix(void){
+    struct rtc_time t = { 0, 0, 0, 1, 1, 1970 }, u;
+    CHECK_EQ(rtc_to_unix(&t), 0);
+    t = (struct rtc_time){ 40, 46, 1, 9, 9, 2001 };
+    CHECK_EQ(rtc_to_unix(&t), 1000000000u);
+    t = (struct rtc_time){ 0, 0, 0, 29, 2, 2024 };
+    CHECK_EQ(rtc_to_unix(&t), 1709164800u);
+    t = (struct rtc_time){ 59, 59, 23, 31, 12, 2069 };
+    CHECK_EQ(rtc_to_unix(&t), 3155759999u);
+
+    /* round trip every day from 1970 to 2100, at 23:59:59 */
+    int bad = 0;
+    for(uint32_t d = 0; d < 47847; d++){
+        uint32_t s = d * 86400u + 86399u;
+        rtc_from_unix(s, &u);
+        if(rtc_to_unix(&u) != s || u.hour != 23 || u.sec != 59) bad++;
+    }
+    CHECK_EQ(bad, 0);
+    rtc_from_unix(1709164800u, &u);
+    CHECK_EQ(u.day, 29); CHECK_EQ(u.month, 2); CHECK_EQ(u.year, 2024);
+}
+
+int main(void){
+    RUN(test_bcd);
+    RUN(test_bcd_24h);
+    RUN(test_12h);
+    RUN(test_uip_and_torn_read);
+    RUN(test_unix);
+    return test_summary("rtc");
+}
@@ -0,0 +1,64 @@
+#include "test.h"
+#include <string.h>
+#include "../src/shell.c"
+
+static void test_strings(void){
+    CHECK_EQ(shell_strlen(""), 0);
+    CHECK_EQ(shell_strlen("tstat"), 5);
+    CHECK(shell_streq("help", "help"));
+    CHECK(!shell_streq("help", "hel"));
+    CHECK(!shell_streq("hel", "help"));
+    CHECK(shell_starts("echo hi", "echo "));
+    CHECK(!shell_starts("ech", "echo "));
+    CHECK(shell_starts("anything", ""));
+
+    char b[16];
+    shell_utoa32(0, b);           CHECK(strcmp(b, "0") == 0);
+    shell_utoa32(4294967295u, b); CHECK(strcmp(b, "4294967295") == 0);
+    shell_hex8(0x00C0FFEEu, b);   CHECK(strcmp(b, "00C0FFEE") == 0);
+}
+
+static void test_parse_uint(void){
+    uint32_t x = 7;
+    const char *p = shell_parse_uint("  4096 rest", &x);
+    CHECK_EQ(x, 4096);
+    CHECK(p && strcmp(p, " rest") == 0);
+    x = 7;
+    CHECK(shell_parse_uint("abc", &x) == 0);
+    CHECK_EQ(x, 7);
+    CHECK(shell_parse_uint("0", &x) != 0);
+    CHECK_EQ(x, 0);
+}
+
+static void test_history(void){
+    CHECK_EQ(history_len(), 0);
+    CHECK(history_last() == 0);
+    history_add("");
+    CHECK_EQ(history_len(), 0);
+
+    char cmd[16];
+    for(int i=0;i<HISTORY_MAX + 3;i++){
+        snprintf(cmd, sizeof cmd, "cmd%d", i);
+        history_add(cmd);
+    }
+    CHECK_EQ(history_len(), HISTORY_MAX);
+    CHECK(strcmp(history_get(0), "cmd3") == 0);               /* oldest kept */
+    CHECK(strcmp(history_last(), "cmd12") == 0);
+    CHECK(history_get(HISTORY_MAX) == 0);
+}
+
+static void test_history_truncates(void){
+    char longcmd[CMD_MAX_LEN + 40];
+    memset(longcmd, 'x', sizeof longcmd - 1);
+    longcmd[sizeof longcmd - 1] = 0;
+    history_add(longcmd);
+    CHECK_EQ(strlen(history_last()), CMD_MAX_LEN - 1);
+}
+
+int main(void){
+    RUN(test_strings);
+    RUN(test_parse_uint);
+    RUN(test_history);
+    RUN(test_history_truncates);
+    return test_summary("shell");
+}
@@ -0,0 +1,63 @@
+#include "test.h"
+#include <string.h>
+#include <sys/mman.h>
+#include "../src/syscall.c"
+
+static char out[2048];
+static uint32_t nout;
+void vga_putc(char c){ if(nout < sizeof out) out[nout++] = c; }
+
+void prog_exit(int id){ (void)id; }
+
+/* the only ring-3 pages of the fake identity map */
+static uint32_t user_lo, user_hi;
+int paging_user_range(uint32_t a, uint32_t n){ return !n || (a >= user_lo && a < user_hi && n <= user_hi - a); }
+
+/* map one page at a fixed address below 4 GiB, or return 0 */
+static char *map_at(uint32_t addr){
+    void *p = mmap((void*)(uintptr_t)addr, 4096, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    return p == MAP_FAILED ? 0 : (char*)p;
+}
+
+static uint32_t sys_write(uint32_t buf, uint32_t len){
+    return syscall_dispatch(SYS_WRITE, buf, len, 0);
+}
+
+static void test_write_bounds(void){
+    const uint32_t bad = (uint32_t)-1;
+    nout = 0;
+    /* ranges whose end wraps past 4 GiB must not look like they end low */
+    CHECK_EQ(sys_write(0xFFFFFF00u, 0x200), bad);
+    CHECK_EQ(sys_write(0xFFFFFFFFu, 1), bad);
+    CHECK_EQ(sys_write(PAGING_USER_END - 1, 2), bad);
+    CHECK_EQ(sys_write(USER_LIMIT - 1, 2), bad);
+    CHECK_EQ(sys_write(USER_LIMIT, 1), bad);
+    CHECK_EQ(sys_write(PAGING_USER_BASE - 1, 1), bad);
+    CHECK_EQ(sys_write(0x1000, WRITE_MAX + 1), bad);
+    CHECK_EQ(nout, 0);
+
+    char *low = map_at(USER_LIMIT - 4096);
+    if(low){
+        memcpy(low + 4096 - 3, "abc", 3);
+        CHECK_EQ(sys_write(USER_LIMIT - 3, 3), bad);     /* supervisor-only */
+        CHECK_EQ(nout, 0);
+        user_lo = USER_LIMIT - 4096;
+        user_hi = USER_LIMIT;
+        CHECK_EQ(sys_write(USER_LIMIT - 3, 3), 3);
+        CHECK(nout == 3 && memcmp(out, "abc", 3) == 0);
+    }
+    char *prog = map_at(PAGING_USER_BASE);
+    if(prog){
+        memcpy(prog, "hi", 2);
+        nout = 0;
+        CHECK_EQ(sys_write(PAGING_USER_BASE, 2), 2);
+        CHECK(nout == 2 && memcmp(out, "hi", 2) == 0);
+    }
+    CHECK_EQ(sys_write(0x1000, 0), 0);
+}
+
+int main(void){
+    RUN(test_write_bounds);
+    return test_summary("syscall");
+}
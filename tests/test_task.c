@@ -0,0 +1,245 @@
+#include "test.h"
+#include <string.h>
+#include "../src/kalloc.h"
+#include "../src/task.c"
+
+uint32_t host_heap_region(size_t len);
+extern uint32_t host_ticks;
+extern uint16_t host_vga_mem[80*25];
+
+static void entry_a(void){ }
+static void entry_b(void){ }
+
+static void setup(void){
+    static uint32_t heap;
+    if(!heap) heap = host_heap_region(1u << 20);
+    kalloc_init(heap);
+    task_init();
+    host_ticks = 0;
+    need_resched = 0;
+    sched_ticks_hint = 0;
+}
+
+static void test_create_ring(void){
+    setup();
+    CHECK_EQ(task_create(entry_a), 1);
+    CHECK_EQ(task_create(entry_b), 2);
+    CHECK_EQ(task_create_user(entry_a), 3);
+    CHECK_EQ(task_head->id, 1);
+    CHECK_EQ(task_head->next->id, 2);
+    CHECK_EQ(task_head->next->next->id, 3);
+    CHECK(task_head->next->next->next == task_head);
+    CHECK_EQ(task_head->next->next->user, 1);
+
+    /* switch frame: 8 regs, EFLAGS, return address = entry */
+    uint32_t *sp = task_head->stack;
+    CHECK_EQ(sp[8], EFLAGS_IF);
+    CHECK_EQ(sp[9], (uint32_t)(uintptr_t)entry_a);
+    CHECK_EQ(task_head->kstack_top, (uint32_t)(uintptr_t)(sp + 10));
+}
+
+static void entry_arg(void *arg){ (void)arg; }
+
+static void test_create_ex(void){
+    setup();
+    int x;
+    CHECK_EQ(task_create_ex(&(struct task_attrs){ .name = "parser-with-long-name", .stack_size = 10000,
+                                                 .entry = entry_arg, .arg = &x }), 1);
+    CHECK_EQ(task_create_ex(&(struct task_attrs){ .entry = entry_arg }), 2);
+    CHECK_EQ(task_create_ex(&(struct task_attrs){ .stack_size = 16, .entry = entry_arg }), 3);
+    task_t *t = task_head;
+    CHECK(strcmp(t->name, "parser-with-lon") == 0);
+    CHECK_EQ(t->stack_size, 10000);
+    CHECK(strcmp(t->next->name, "task") == 0);
+    CHECK_EQ(t->next->stack_size, TASK_STACK_DEFAULT);
+    CHECK_EQ(t->next->next->stack_size, TASK_STACK_MIN);
+
+    /* 8 regs, EFLAGS, entry, then entry's frame: return to task_exit, arg */
+    uint32_t *sp = t->stack;
+    CHECK_EQ(sp[9],  (uint32_t)(uintptr_t)entry_arg);
+    CHECK_EQ(sp[10], (uint32_t)(uintptr_t)task_exit);
+    CHECK_EQ(sp[11], (uint32_t)(uintptr_t)&x);
+    CHECK_EQ(t->kstack_top, (uint32_t)(uintptr_t)(sp + 12));
+}
+
+static void test_tcb_above_stack(void){
+    setup();
+    task_create(entry_a); task_create(entry_b);
+    /* a task's TCB lies above its own stack, never below it */
+    for(task_t *t = task_head; ; t = t->next){
+        CHECK((uintptr_t)t >= (uintptr_t)t->stack_base + t->stack_size);
+        if(t->next == task_head) break;
+    }
+}
+
+static void test_overrun_spares_neighbour(void){
+    setup();
+    task_create(entry_a); task_create(entry_b);
+    task_t *a = task_head, *b = a->next;
+    task_t saved = *a;
+    /* b overruns its guard and its whole gap, but not into the next block */
+    for(int i = -(int)(TASK_STACK_GAP/4); i < TASK_STACK_GUARD; i++) b->stack_base[i] = 0;
+    CHECK(memcmp(a, &saved, sizeof saved) == 0);
+    CHECK(a->next == b && a->stack_base == saved.stack_base);
+    CHECK((uintptr_t)(b->stack_base - TASK_STACK_GAP/4) >= (uintptr_t)(a + 1));
+    current_task = a;
+    task_yield();
+    current_task = b;
+    task_yield();                            /* b is caught and unlinked */
+    CHECK_EQ(task_current_id(), 1);
+    CHECK(task_head->next == task_head);
+}
+
+static void test_stack_peak(void){
+    setup();
+    task_create(entry_a);
+    task_t *t = task_head;
+    CHECK_EQ(task_stack_peak(t), 10*4);      /* just the initial frame */
+    t->stack_base[TASK_STACK_DEFAULT/4 - 300] = 0;
+    CHECK_EQ(task_stack_peak(t), 300*4);
+    CHECK_EQ(t->stack_base[TASK_STACK_GUARD], TASK_STACK_CANARY);
+}
+
+static void test_overflow_killed(void){
+    setup();
+    task_create(entry_a); task_create(entry_b); task_create(entry_b);
+    current_task = task_head->next;
+    current_task->stack_base[TASK_STACK_GUARD - 1] = 0;   /* top guard word hit */
+    task_yield();
+    CHECK_EQ(task_current_id(), 3);
+    CHECK_EQ(task_head->next->id, 3);         /* task 2 unlinked */
+    task_yield();
+    CHECK_EQ(task_current_id(), 1);
+
+    current_task->stack = current_task->stack_base;   /* saved ESP in the guard */
+    task_yield();
+    CHECK_EQ(task_current_id(), 3);
+    CHECK(task_head->next == task_head);
+}
+
+static void test_round_robin(void){
+    setup();
+    task_create(entry_a); task_create(entry_b); task_create(entry_b);
+    current_task = task_head;
+    task_yield(); CHECK_EQ(task_current_id(), 2);
+    task_yield(); CHECK_EQ(task_current_id(), 3);
+    task_yield(); CHECK_EQ(task_current_id(), 1);
+}
+
+static void test_tick_accounting(void){
+    setup();
+    task_create(entry_a); task_create(entry_b);
+    current_task = task_head;
+    for(int i=0;i<6;i++) task_on_tick(1);
+    task_on_tick(3);                         /* caught up after a stopped tick */
+    CHECK_EQ(current_task->run_ticks, 9);
+    CHECK_EQ(need_resched, 0);
+    task_on_tick(1);
+    CHECK_EQ(need_resched, 1);
+    scheduler_maybe_yield();
+    CHECK_EQ(need_resched, 0);
+    CHECK_EQ(task_current_id(), 2);
+}
+
+static void test_sleep_and_block(void){
+    setup();
+    task_create(entry_a); task_create(entry_b);
+    current_task = task_head;
+
+    /* task 1 sleeps 5 ticks, task 2 blocks: nothing is runnable, so
+       pick_next idles (advancing the fake clock) until task 1 wakes */
+    CHECK_EQ(task_sleep(5), 5);
+    CHECK_EQ(task_current_id(), 2);
+    task_block();
+    CHECK_EQ(task_current_id(), 1);
+    CHECK_EQ(host_ticks, 5);
+    CHECK_EQ(task_head->next->state, TASK_BLOCKED);
+
+    task_wake(2);
+    CHECK_EQ(task_head->next->state, TASK_READY);
+    task_yield();
+    CHECK_EQ(task_current_id(), 2);
+}
+
+static void test_nohz_state(void){
+    setup();
+    task_create(entry_a); task_create(entry_b); task_create(entry_b);
+    current_task = task_head;
+    uint32_t until;
+    CHECK_EQ(task_nohz_state(0, &until), 3);
+    CHECK_EQ(until, 0xFFFFFFFFu);
+
+    /* task 1 sleeps 7 ticks, task 2 sleeps 4, task 3 blocks: none runnable */
+    task_head->state = TASK_SLEEPING;        task_head->wake_tick = 7;
+    task_head->next->state = TASK_SLEEPING;  task_head->next->wake_tick = 4;
+    task_head->next->next->state = TASK_BLOCKED;
+    CHECK_EQ(task_nohz_state(0, &until), 0);
+    CHECK_EQ(until, 4);
+    CHECK_EQ(task_nohz_state(5, &until), 1);  /* task 2 woke */
+    CHECK_EQ(until, 2);
+
+    /* the shell blocked in kbd_getch plus one hog: a single runnable task */
+    task_head->state = TASK_BLOCKED;
+    task_head->next->state = TASK_READY;
+    CHECK_EQ(task_nohz_state(5, &until), 1);
+    CHECK_EQ(until, 0xFFFFFFFFu);
+}
+
+static void test_kill(void){
+    setup();
+    task_create(entry_a); task_create(entry_b); task_create(entry_b);
+    current_task = task_head;
+    CHECK_EQ(task_kill(2), 0);
+    CHECK_EQ(task_kill(2), -1);
+    CHECK_EQ(task_kill(9), -1);
+    CHECK_EQ(task_head->next->id, 3);
+    task_yield(); CHECK_EQ(task_current_id(), 3);
+    task_yield(); CHECK_EQ(task_current_id(), 1);
+
+    /* killing the head moves it to the next task */
+    current_task = task_head->next;
+    CHECK_EQ(task_kill(1), 0);
+    CHECK_EQ(task_head->id, 3);
+    CHECK(task_head->next == task_head);
+}
+
+static void test_stats_output(void){
+    setup();
+    task_create(entry_a); task_create(entry_b);
+    current_task = task_head;
+    for(int i=0;i<3;i++) task_on_tick(1);
+    task_yield();
+    task_on_tick(1);
+    for(int i=0;i<80*25;i++) host_vga_mem[i] = ' ';
+    task_stats_print();
+    char line[81] = {0};
+    for(int y=0;y<25;y++){
+        for(int x=0;x<80;x++) line[x] = (char)host_vga_mem[y*80+x];
+        if(strncmp(line, "task 1  ticks=3  share=75%", 26) == 0) return;
+    }
+    CHECK(!"task 1 stats line not found");
+}
+
+static void bench(void){
+    setup();
+    for(int i=0;i<8;i++) task_create(entry_a);
+    current_task = task_head;
+    BENCH("task_pick_next (8 ready)", 4000000, 100000, (void)0, task_pick_next());
+}
+
+int main(void){
+    RUN(test_create_ring);
+    RUN(test_create_ex);
+    RUN(test_tcb_above_stack);
+    RUN(test_overrun_spares_neighbour);
+    RUN(test_stack_peak);
+    RUN(test_overflow_killed);
+    RUN(test_round_robin);
+    RUN(test_tick_accounting);
+    RUN(test_sleep_and_block);
+    RUN(test_nohz_state);
+    RUN(test_kill);
+    RUN(test_stats_output);
+    RUN(bench);
+    return test_summary("task");
+}
@@ -0,0 +1,92 @@
+#include "test.h"
+#include "../src/vga.c"
+
+extern uint16_t host_vga_mem[80*25];
+
+static char cell_char(int x, int y){ return (char)(host_vga_mem[y*80+x] & 0xFF); }
+static uint8_t cell_attr(int x, int y){ return (uint8_t)(host_vga_mem[y*80+x] >> 8); }
+
+static void test_write(void){
+    vga_set_color(0x0F);
+    vga_clear();
+    vga_write("hi");
+    CHECK_EQ(cell_char(0,0), 'h');
+    CHECK_EQ(cell_char(1,0), 'i');
+    CHECK_EQ(cell_attr(0,0), 0x0F);
+    vga_writeln("!");
+    vga_write("x");
+    CHECK_EQ(cell_char(2,0), '!');
+    CHECK_EQ(cell_char(0,1), 'x');
+}
+
+static void test_backspace_and_color(void){
+    vga_clear();
+    vga_write("ab");
+    vga_putc('\b');
+    CHECK_EQ(cell_char(1,0), ' ');
+    vga_putc('c');
+    CHECK_EQ(cell_char(1,0), 'c');
+    vga_write_color("z", 0x1E);
+    CHECK_EQ(cell_attr(2,0), 0x1E);
+    vga_write("w");
+    CHECK_EQ(cell_attr(3,0), 0x0F);
+}
+
+static void test_wrap_and_scroll(void){
+    vga_clear();
+    for(int i=0;i<80;i++) vga_putc('a');
+    vga_putc('b');
+    CHECK_EQ(cell_char(0,1), 'b');
+
+    vga_clear();
+    char line[4] = "L0";
+    for(int i=0;i<25;i++){ line[1] = (char)('A' + i); vga_writeln(line); }
+    /* 25 newlines: the first line scrolled off, bottom row is blank */
+    CHECK_EQ(cell_char(1,0), 'B');
+    CHECK_EQ(cell_char(1,23), 'Y');
+    CHECK_EQ(cell_char(0,24), ' ');
+}
+
+static void test_write_at(void){
+    vga_set_color(0x0F);
+    vga_clear();
+    vga_write("ab");
+    uint32_t before = vga_bytes_written();
+    vga_write_at(10, 3, "top", 6);
+    CHECK_EQ(cell_char(10,3), 't');
+    CHECK_EQ(cell_char(12,3), 'p');
+    CHECK_EQ(cell_char(13,3), ' ');
+    CHECK_EQ(vga_bytes_written(), before);      /* not console stream output */
+
+    /* cursor untouched: the stream continues after "ab" */
+    vga_write("c");
+    CHECK_EQ(cell_char(2,0), 'c');
+
+    /* unchanged cells are not rewritten */
+    host_vga_mem[3*80+10] = (uint16_t)('t' | 0x0F00);
+    host_vga_mem[3*80+15] = 0x4141;             /* beyond width: untouched */
+    vga_write_at(10, 3, "tip", 5);
+    CHECK_EQ(cell_char(11,3), 'i');
+    CHECK_EQ(host_vga_mem[3*80+15], 0x4141);
+
+    /* clipped at the right edge */
+    vga_write_at(78, 0, "xyz", 3);
+    CHECK_EQ(cell_char(79,0), 'y');
+    CHECK_EQ(cell_char(0,1), ' ');
+}
+
+static void bench(void){
+    static const char line[] = "0123456789012345678901234567890123456789012345678901234567890123456789";
+    BENCH("vga_writeln(70 chars)", 200000, 1000, vga_clear(), vga_writeln(line));
+    BENCH("vga_putc", 4000000, 1000, vga_clear(), vga_putc('x'));
+    BENCH("vga_write_at(unchanged line)", 2000000, 1000, vga_write_at(0, 5, line, 80), vga_write_at(0, 5, line, 80));
+}
+
+int main(void){
+    RUN(test_write);
+    RUN(test_backspace_and_color);
+    RUN(test_wrap_and_scroll);
+    RUN(test_write_at);
+    RUN(bench);
+    return test_summary("vga");
+}
@@ -0,0 +1,37 @@
+/* Sample program for `run hello`: writes through SYS_WRITE, touches a few
+   pages of a large .bss array (faulted in on first use) and exits. */
+#include "../src/syscall.h"
+
+static char scratch[256*1024];          /* .bss: only touched pages become resident */
+static int  rounds = 3;                 /* .data: private copy per run */
+static const char banner[] = "[hello] running from a boot module, pid ";
+
+static uint32_t slen(const char *s){ uint32_t n=0; while(s[n]) n++; return n; }
+static void puts_u(const char *s){ usys_int80(SYS_WRITE, (uint32_t)s, slen(s), 0); }
+
+static void put_u32(uint32_t x){
+    char t[12]; int i = 11;
+    t[i] = 0;
+    do { t[--i] = '0' + x % 10u; x /= 10u; } while(x);
+    puts_u(&t[i]);
+}
+
+__attribute__((section(".text.start")))
+void _start(void){
+    puts_u(banner);
+    put_u32(usys_int80(SYS_GETPID, 0, 0, 0));
+    puts_u("\n");
+
+    uint32_t touched = 0;
+    for(uint32_t off = 0; off < sizeof(scratch); off += 64*1024) scratch[off] = 1;
+    for(uint32_t off = 0; off < sizeof(scratch); off += 64*1024) touched += scratch[off];
+    puts_u("[hello] touched "); put_u32(touched); puts_u(" of "); put_u32(sizeof(scratch)/4096);
+    puts_u(" .bss pages\n");
+
+    while(rounds-- > 0){
+        puts_u("[hello] tick\n");
+        usys_int80(SYS_SLEEP, 50, 0, 0);
+    }
+    usys_int80(SYS_EXIT, 0, 0, 0);
+    for(;;);
+}